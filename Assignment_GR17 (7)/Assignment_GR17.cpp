@@ -1,9 +1,27 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 #include <iostream>
 #include <vector>
 #include <string>
 #include <iomanip>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <fstream>
 #include <thread>
 #include <chrono>
@@ -11,26 +29,202 @@
 #include <algorithm>
 #include <stack>
 #include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <string_view>
+#include <charconv>
+#include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <cerrno>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
 
 
 using namespace std;
 
+// An amount of money in sen (1/100 RM). Prices and totals are whole integers,
+// so sums are exact and never drift the way double accumulations do.
+struct Money 
+{
+    int64_t cents = 0;
+
+    Money() {}
+    explicit Money(int64_t c) : cents(c) {}
+
+    // Accepts "20", "7.8", "7.80", " 7.80 " or "-1.5"; more than two decimals is an error
+    static bool parse(string_view text, Money& out) 
+	{
+        while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\r')) text.remove_suffix(1);
+
+        bool negative = !text.empty() && text.front() == '-';
+        if (negative) 
+		{
+            text.remove_prefix(1);
+        }
+
+        size_t dot = text.find('.');
+        string_view whole = text.substr(0, dot);
+        string_view fraction = dot == string_view::npos ? string_view() : text.substr(dot + 1);
+        if ((whole.empty() && fraction.empty()) || fraction.size() > 2) 
+		{
+            return false;
+        }
+
+        int64_t units = 0;
+        if (!whole.empty()) 
+		{
+            // from_chars takes a sign of its own, which would let "--5" through
+            if (whole.front() < '0' || whole.front() > '9') 
+			{
+                return false;
+            }
+            auto result = from_chars(whole.data(), whole.data() + whole.size(), units);
+            if (result.ec != errc() || result.ptr != whole.data() + whole.size() || units > INT64_MAX / 100 - 1) 
+			{
+                return false;
+            }
+        }
+
+        int64_t sen = 0;
+        for (size_t i = 0; i < 2; ++i) 
+		{
+            sen *= 10;
+            if (i < fraction.size()) 
+			{
+                if (fraction[i] < '0' || fraction[i] > '9') 
+				{
+                    return false;
+                }
+                sen += fraction[i] - '0';
+            }
+        }
+
+        int64_t total = units * 100 + sen;
+        out.cents = negative ? -total : total;
+        return true;
+    }
+
+    // Writes "7.80" into [first, last) and returns the end, like to_chars
+    char* format(char* first, char* last) const 
+	{
+        uint64_t magnitude = cents < 0 ? 0 - (uint64_t)cents : (uint64_t)cents;
+        if (cents < 0 && first != last) 
+		{
+            *first++ = '-';
+        }
+        first = to_chars(first, last, magnitude / 100).ptr;
+        if (last - first >= 3) 
+		{
+            uint64_t sen = magnitude % 100;
+            *first++ = '.';
+            *first++ = (char)('0' + sen / 10);
+            *first++ = (char)('0' + sen % 10);
+        }
+        return first;
+    }
+
+    string toString() const 
+	{
+        char buffer[32];
+        return string(buffer, format(buffer, buffer + sizeof(buffer)));
+    }
+
+    Money& operator+=(Money other) { cents += other.cents; return *this; }
+    Money operator+(Money other) const { return Money(cents + other.cents); }
+    Money operator-(Money other) const { return Money(cents - other.cents); }
+    Money operator*(int quantity) const { return Money(cents * quantity); }
+
+    bool operator==(Money other) const { return cents == other.cents; }
+    bool operator!=(Money other) const { return cents != other.cents; }
+    bool operator<(Money other) const { return cents < other.cents; }
+    bool operator>(Money other) const { return cents > other.cents; }
+    bool operator<=(Money other) const { return cents <= other.cents; }
+    bool operator>=(Money other) const { return cents >= other.cents; }
+
+    // Sum of many amounts held in sen. Integer adds are associative, so the loop
+    // can be split across SIMD lanes without changing the result.
+    static Money sum(const int64_t* values, size_t count) 
+	{
+        size_t i = 0;
+        int64_t total = 0;
+#if defined(__AVX2__)
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 4 <= count; i += 4) 
+		{
+            acc = _mm256_add_epi64(acc, _mm256_loadu_si256((const __m256i*)(values + i)));
+        }
+        int64_t lanes[4];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 2 <= count; i += 2) 
+		{
+            acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i*)(values + i)));
+        }
+        int64_t lanes[2];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        total = lanes[0] + lanes[1];
+#endif
+        for (; i < count; ++i) 
+		{
+            total += values[i];
+        }
+        return Money(total);
+    }
+};
+
+inline Money operator*(int quantity, Money price) { return price * quantity; }
+
+// Written as one string so setw() pads the whole amount
+inline ostream& operator<<(ostream& os, Money amount) 
+{
+    return os << amount.toString();
+}
+
+// Reads like >> double: skips leading whitespace and stops at the first character
+// that cannot be part of an amount, so "20,Sun Jun" leaves ",Sun Jun" in the stream
+inline istream& operator>>(istream& is, Money& amount) 
+{
+    string text;
+    is >> ws;
+    while (is && (isdigit(is.peek()) || is.peek() == '.' || (is.peek() == '-' && text.empty()))) 
+	{
+        text += (char)is.get();
+    }
+    if (!Money::parse(text, amount)) 
+	{
+        is.setstate(ios::failbit);
+    }
+    return is;
+}
+
+// The strings point into storage owned by the MenuCatalog: the mapped menu.bin
+// or its arena. A copy of an item is only valid while that catalog is.
 struct MenuItem 
 {
-    string code;
-    string name;
-    string category;
-    double price;
+    string_view code;
+    string_view name;
+    string_view category;
+    Money price;
 };
 
 struct OrderItem 
 {
     string item;
     int quantity;
-    double price;
+    Money price;
     string username;
     string orderTime;
     string dineOption; 
+    uint32_t itemId = 0;  // packed menu code
 };
 
 struct Order 
@@ -39,16 +233,41 @@ struct Order
     string dineOption;
     string foodDetails;
     int quantity;
-    double price;
+    Money price;
     string orderTime;
     time_t parsedOrderTime;
-    double totalPrice; 
+    Money totalPrice; 
+    uint32_t itemId = 0;  // packed menu code, 0 when unknown
+    uint64_t orderId = 0;  // checkout the line belongs to, 0 when unknown
     
     bool operator<(const Order &other) const {
         return parsedOrderTime < other.parsedOrderTime;
     }
 };
 
+// One checkout: who ordered, when, and what it came to. Its items are the
+// OrderBook lines [firstLine, firstLine + lineCount); names are ids into the
+// OrderBook's dictionary.
+struct OrderHeader 
+{
+    uint64_t orderId = 0;
+    uint32_t customerId = 0;
+    uint32_t dineId = 0;
+    time_t orderTime = 0;
+    Money total;
+    uint32_t firstLine = 0;
+    uint32_t lineCount = 0;
+};
+
+// One item of a checkout
+struct OrderLine 
+{
+    uint32_t foodId = 0;  // name, as an id into the OrderBook's dictionary
+    uint32_t itemId = 0;  // packed menu code, 0 when unknown
+    int quantity = 0;
+    Money price;          // unit price
+};
+
 
 class Stack {
 private:
@@ -91,327 +310,6234 @@ public:
     }
 };
 
-class SearchItem 
+// Read-only view of a whole file. The OS maps the pages in on demand,
+// so large files are never copied through an ifstream buffer.
+class MappedFile 
 {
-public:
-    static vector<MenuItem> searchByPriceRange(const vector<MenuItem>& menu, double minPrice, double maxPrice) {
-        // Sort menu items by price for binary search
-        std::vector<MenuItem> sortedMenu = menu;
-        std::sort(sortedMenu.begin(), sortedMenu.end(), [](const MenuItem& a, const MenuItem& b) {
-            return a.price < b.price;
-        });
-
-        // Perform binary search using std::lower_bound and std::upper_bound
-        auto lower = lower_bound(sortedMenu.begin(), sortedMenu.end(), minPrice, [](const MenuItem& item, double price) {
-            return item.price < price;
-        });
-
-        auto upper = upper_bound(sortedMenu.begin(), sortedMenu.end(), maxPrice, [](double price, const MenuItem& item) {
-            return price < item.price;
-        });
-
-        // Create a vector to hold the result
-        vector<MenuItem> result(lower, upper);
-
-        return result;
-    }
+private:
+    const char* ptr = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
 
-	static vector<MenuItem> searchByCategory(const std::vector<MenuItem>& menu, const std::string& category) {
-        // Sort menu items by category for binary search
-        vector<MenuItem> sortedMenu = menu;
-        sort(sortedMenu.begin(), sortedMenu.end(), [](const MenuItem& a, const MenuItem& b) {
-            return a.category < b.category;
-        });
+public:
+    MappedFile() {}
+    explicit MappedFile(const string& path) { open(path); }
+    ~MappedFile() { close(); }
 
-        // Perform binary search using std::binary_search
-        auto it = std::lower_bound(sortedMenu.begin(), sortedMenu.end(), category, [](const MenuItem& item, const string& cat) {
-            return item.category < cat;
-        });
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
 
-        // Create a vector to hold the result
-        vector<MenuItem> result;
-        
-        // Iterate from the lower bound to find all items with the given category
-        while (it != sortedMenu.end() && it->category == category) {
-            result.push_back(*it);
-            ++it;
+    bool open(const string& path) 
+	{
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) 
+		{
+            return false;
         }
-
-        return result;
-    }
-    
-    // Overloaded search function for searching by name
-    static vector<MenuItem> searchByName(const vector<MenuItem>& menu, const string& name) {
-        vector<MenuItem> result;
-        for (const auto& item : menu) {
-            if (item.name == name) {
-                result.push_back(item);
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        length = (size_t)fileSize.QuadPart;
+        if (length > 0) 
+		{
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            ptr = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!ptr) 
+			{
+                close();
+                return false;
             }
         }
-        return result;
-    }
-
-    // Overloaded search function for searching by code
-    static vector<MenuItem> searchByCode(const vector<MenuItem>& menu, const string& code) {
-        vector<MenuItem> result;
-        for (const auto& item : menu) {
-            if (item.code == code) {
-                result.push_back(item);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) 
+		{
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) 
+		{
+            ::close(fd);
+            return false;
+        }
+        length = (size_t)st.st_size;
+        if (length > 0) 
+		{
+            void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) 
+			{
+                ::close(fd);
+                length = 0;
+                return false;
             }
+            ptr = (const char*)addr;
         }
-        return result;
+        ::close(fd);  // the mapping stays valid after the descriptor is closed
+#endif
+        opened = true;
+        return true;
     }
 
-};
+    void close() 
+	{
+#ifdef _WIN32
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (ptr) munmap((void*)ptr, length);
+#endif
+        ptr = nullptr;
+        length = 0;
+        opened = false;
+    }
 
+    bool isOpen() const { return opened; }
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+    string_view view() const { return string_view(ptr, length); }
+};
 
-class Algorithm 
+// Write-only handle opened in append mode and kept open, so every write lands
+// at the current end of file without reopening it per order.
+class AppendFile 
 {
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+
 public:
-    static void bubbleSortMenuByName(vector<MenuItem>& menu) 
+    AppendFile() {}
+    ~AppendFile() { close(); }
+
+    AppendFile(const AppendFile&) = delete;
+    AppendFile& operator=(const AppendFile&) = delete;
+
+    // With truncate set, whatever the file held before is discarded
+    bool open(const string& path, bool truncate = false) 
 	{
-        int n = menu.size();
-        for (int i = 0; i < n - 1; ++i) 
+        close();
+#ifdef _WIN32
+        // GENERIC_READ is only there because LockFileEx requires read or write access
+        file = CreateFileA(path.c_str(), FILE_APPEND_DATA | GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        return file != INVALID_HANDLE_VALUE;
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0), 0644);
+        return fd >= 0;
+#endif
+    }
+
+    // Writes all of data, retrying short writes
+    bool write(const char* data, size_t length) 
+	{
+        while (length > 0) 
 		{
-            for (int j = 0; j < n - i - 1; ++j) 
+#ifdef _WIN32
+            DWORD written = 0;
+            DWORD chunk = length > 0x40000000 ? 0x40000000 : (DWORD)length;
+            if (!WriteFile(file, data, chunk, &written, NULL)) 
 			{
-                if (menu[j].name > menu[j + 1].name) 
-				{
-                    swap(menu[j], menu[j + 1]);
-                }
+                return false;
+            }
+#else
+            ssize_t written = ::write(fd, data, length);
+            if (written < 0) 
+			{
+                if (errno == EINTR) continue;
+                return false;
             }
+#endif
+            data += written;
+            length -= (size_t)written;
         }
+        return true;
     }
 
-    static void bubbleSortMenuByPrice(vector<MenuItem>& menu) 
-	{
-    int n = menu.size();
-    for (int i = 0; i < n - 1; ++i) 
+    // Blocks until no other process holds the lock, then takes it. The lock is
+    // advisory: it only keeps out writers that lock() as well. On Windows it is a
+    // byte far past any real end of file, so locking it never blocks reads or appends.
+    bool lock() 
 	{
-        for (int j = 0; j < n - i - 1; ++j) 
+#ifdef _WIN32
+        OVERLAPPED where = {};
+        where.Offset = 0xFFFFFFFF;
+        where.OffsetHigh = 0x7FFFFFFF;
+        return LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &where) != 0;
+#else
+        while (flock(fd, LOCK_EX) != 0) 
 		{
-            if (menu[j].price < menu[j + 1].price) 
-			{  // Change comparison to <
-                swap(menu[j], menu[j + 1]);
-            }
+            if (errno != EINTR) return false;
         }
+        return true;
+#endif
     }
-}
-
-};
 
-// Base class
-class User 
-{
-protected:
-    string username;
-    string password;
-public:
-    User(const string& u, const string& p) : username(u), password(p) {}
-
-    // Virtual login function
-    virtual bool login(const string& u, const string& p)
-	 {
-        return username == u && password == p;
+    void unlock() 
+	{
+#ifdef _WIN32
+        OVERLAPPED where = {};
+        where.Offset = 0xFFFFFFFF;
+        where.OffsetHigh = 0x7FFFFFFF;
+        UnlockFileEx(file, 0, 1, 0, &where);
+#else
+        flock(fd, LOCK_UN);
+#endif
     }
 
-    friend void displayUserDetails(const User& user);
-};
-
-void displayUserDetails(const User& user) 
-{
-    cout << "Username: " << user.username << endl;
-}
+    // Returns once everything written so far is on stable storage
+    bool sync() 
+	{
+#ifdef _WIN32
+        return FlushFileBuffers(file) != 0;
+#else
+        return fsync(fd) == 0;
+#endif
+    }
 
-// Derived class for Customer
-class Customer : public User 
-{
-public:
-    Customer(const string& u, const string& p) : User(u, p) {}
+    void close() 
+	{
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+    }
 
-    // Overridden login function
-    bool login(const string& u, const string& p) override 
+    bool isOpen() const 
 	{
-        if (User::login(u, p)) 
-		{
-            cout << "Customer login successful" << endl;
-            return true;
-        }
-        cout << "Customer login failed" << endl;
-        return false;
+#ifdef _WIN32
+        return file != INVALID_HANDLE_VALUE;
+#else
+        return fd >= 0;
+#endif
     }
 };
 
-// Derived class for Admin
-class Admin : public User 
+// Output file for exports. Rows are formatted straight into one reusable buffer
+// that goes to disk in whole blocks, so an export of any size uses the same
+// memory and makes one write call per block. Progress is reported at most once
+// a second while the file grows.
+class ExportFile 
 {
 public:
-    Admin(const string& u, const string& p) : User(u, p) {}
+    static const size_t BLOCK_BYTES = 4 * 1024 * 1024;
+    static const size_t PIECE_ROWS = 8192;  // rows (or checkouts) one export task formats
 
-    bool login(const string& u, const string& p) override {
-        if (User::login(u, p)) {
-            cout << "Successfully logged in!" << endl;
-            return true;
-        } else {
-            cout << "Invalid username and password! Please enter again." << endl;
-            return false;
-        }
-    }
+private:
+    AppendFile file;
+    string path;
+    string buffer;
+    uint64_t rows = 0;
+    uint64_t written = 0;
+    chrono::steady_clock::time_point lastReport;
+    bool reported = false;
 
-    
-    MenuItem getMenuItemDetails(const string& code, const map<string, MenuItem>& menuMap) 
-	{
-    if (menuMap.find(code) != menuMap.end()) 
-	{
-        return menuMap.at(code);
-    } 
-	else 
+public:
+    // With append set, rows go after what the file already holds
+    bool open(const string& exportPath, bool append = false) 
 	{
-        // Return a default MenuItem or throw an exception if needed
-        return MenuItem(); // Replace with appropriate handling as per your design
+        path = exportPath;
+        buffer.clear();
+        buffer.reserve(BLOCK_BYTES * 2);
+        rows = written = 0;
+        reported = false;
+        lastReport = chrono::steady_clock::now();
+        return file.open(path, !append);
     }
-	}
-    
 
-    void addMenuItem(vector<MenuItem>& menu, const MenuItem& item) 
+    // Formatters append to this; call endRow() after each row
+    string& out() { return buffer; }
+
+    bool endRow() 
 	{
-        menu.push_back(item);
+        ++rows;
+        return buffer.size() < BLOCK_BYTES || writeBlocks(false);
     }
 
-    void removeMenuItem(vector<MenuItem>& menu, const string& code) 
+    // Appends rows formatted elsewhere
+    bool write(string_view bytes, uint64_t rowCount) 
 	{
-        auto it = remove_if(menu.begin(), menu.end(), [&](const MenuItem& item) { return item.code == code; });
-        menu.erase(it, menu.end());
+        buffer.append(bytes.data(), bytes.size());
+        rows += rowCount;
+        return buffer.size() < BLOCK_BYTES || writeBlocks(false);
     }
 
-    void editMenuItem(vector<MenuItem>& menu, map<string, MenuItem>& menuMap, const string& code) 
+    // Writes out what is left; false if any write failed
+    bool close() 
 	{
-        for (auto& item : menu) 
+        bool ok = writeBlocks(true);
+        file.close();
+        if (reported) 
 		{
-            if (item.code == code) 
-			{
-                cout << "Editing item with code: " << code << endl;
-                cout << "Enter new name (or press enter to keep current): ";
-                string newName;
-                cin.ignore();
-                getline(cin, newName);
-                if (!newName.empty()) 
-				{
-                    item.name = newName;
-                }
-
-                cout << "Enter new category (or press enter to keep current): ";
-                string newCategory;
-                getline(cin, newCategory);
-                if (!newCategory.empty()) 
-				{
-                    item.category = newCategory;
-                }
-
-                cout << "Enter new price (or press enter to keep current): ";
-                string priceStr;
-                getline(cin, priceStr);
-                if (!priceStr.empty()) 
-				{
-                    item.price = stod(priceStr);
-                }
-
-                // Update the menu map
-                menuMap[item.code] = item;
-
-                cout << "Item updated successfully." << endl;
-                break;
-            }
+            cout << endl;
         }
+        buffer.clear();
+        buffer.shrink_to_fit();
+        return ok;
     }
 
-    void saveMenuToFile(const vector<MenuItem>& menu) 
+    uint64_t rowCount() const { return rows; }
+
+private:
+    bool writeBlocks(bool all) 
 	{
-        ofstream menuFile("menu.txt");
-        if (!menuFile) 
+        size_t length = all ? buffer.size() : buffer.size() - buffer.size() % BLOCK_BYTES;
+        if (!file.write(buffer.data(), length)) 
 		{
-            cerr << "Failed to open menu.txt" << endl;
-            return;
+            return false;
         }
+        buffer.erase(0, length);
+        written += length;
 
-        for (const auto& item : menu) 
+        auto now = chrono::steady_clock::now();
+        if (!all && now - lastReport >= chrono::seconds(1)) 
 		{
-            menuFile << item.code << "," << item.name << "," << item.category << "," << item.price << endl;
+            cout << "\rExporting to " << path << ": " << rows << " rows, " << written / (1024 * 1024) << " MB" << flush;
+            lastReport = now;
+            reported = true;
         }
-
-        menuFile.close();
-        cout << "Menu saved to menu.txt" << endl;
+        return true;
     }
-    
-    friend void displayAdminDetails(const Admin& admin);
-
 };
 
-
-void displayAdminDetails(const Admin& admin) 
-{
-    cout << "Admin Username: " << admin.username << endl;
-}
-
-class FastFoodOrderingSystem 
+// A fixed set of worker threads for bulk jobs (parsing, sorting, formatting).
+// run() hands out task indexes to the workers and the calling thread alike and
+// returns when every index is done. Calls made from inside a task run inline.
+class ThreadPool 
 {
 private:
-    vector<MenuItem> menu;
-    map<string, MenuItem> menuMap;
-    vector<MenuItem> originalMenu;
-    vector<OrderItem> orders;
-    Stack orderHistory;
-    //stack<string> orderHistory; // Stack to store order history
-    string customerName;
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake;
+    condition_variable finished;
+    mutex runLock;  // one job at a time
+
+    const function<void(size_t)>* task = nullptr;
+    size_t taskCount = 0;
+    atomic<size_t> nextIndex{0};
+    size_t active = 0;       // workers currently inside the job
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    static bool& insideTask() 
+	{
+        static thread_local bool inside = false;
+        return inside;
+    }
 
-    void loadMenu() 
+public:
+    explicit ThreadPool(unsigned threads) 
 	{
-        ifstream menuFile("menu.txt");
-        if (!menuFile) 
+        for (unsigned i = 0; i < threads; ++i) 
 		{
-            cerr << "Failed to open menu.txt" << endl;
-            exit(1);
+            workers.emplace_back(&ThreadPool::workerLoop, this);
         }
+    }
 
-        string line;
-        while (getline(menuFile, line)) 
+    ~ThreadPool() 
+	{
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) 
 		{
-            MenuItem item;
-            size_t pos = 0;
-            pos = line.find(',');
-            item.code = line.substr(0, pos);
-            line.erase(0, pos + 1);
+            worker.join();
+        }
+    }
 
-            pos = line.find(',');
-            item.name = line.substr(0, pos);
-            line.erase(0, pos + 1);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
 
-            pos = line.find(',');
-            item.category = line.substr(0, pos);
-            line.erase(0, pos + 1);
+    // One worker per extra core; the thread calling run() is the last one
+    static ThreadPool& shared() 
+	{
+        static ThreadPool pool(max(1u, thread::hardware_concurrency()) - 1);
+        return pool;
+    }
 
-            item.price = stod(line);
+    // Threads that take part in run(), counting the caller
+    size_t size() const { return workers.size() + 1; }
 
-            menu.push_back(item);
-            originalMenu.push_back(item);
-            menuMap[item.code] = item;
+    void run(size_t count, const function<void(size_t)>& body) 
+	{
+        if (count == 0) 
+		{
+            return;
+        }
+        if (count == 1 || workers.empty() || insideTask()) 
+		{
+            for (size_t i = 0; i < count; ++i) body(i);
+            return;
         }
 
-        menuFile.close();
-    }
+        lock_guard<mutex> single(runLock);
+        {
+            lock_guard<mutex> guard(lock);
+            task = &body;
+            taskCount = count;
+            nextIndex.store(0);
+            ++generation;
+        }
+        wake.notify_all();
+
+        work(body, count);
+
+        // The job's state must outlive every worker still holding it
+        unique_lock<mutex> guard(lock);
+        finished.wait(guard, [this] { return active == 0; });
+        task = nullptr;
+    }
+
+private:
+    void work(const function<void(size_t)>& body, size_t count) 
+	{
+        insideTask() = true;
+        for (size_t i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1)) 
+		{
+            body(i);
+        }
+        insideTask() = false;
+    }
+
+    void workerLoop() 
+	{
+        uint64_t seen = 0;
+        while (true) 
+		{
+            const function<void(size_t)>* body;
+            size_t count;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || (task && generation != seen); });
+                if (stopping) 
+				{
+                    return;
+                }
+                seen = generation;
+                body = task;
+                count = taskCount;
+                ++active;
+            }
+
+            work(*body, count);
+
+            lock_guard<mutex> guard(lock);
+            if (--active == 0) 
+			{
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+// CRC-32C (Castagnoli), table driven. Used to checksum the binary files we write.
+class Crc32c 
+{
+public:
+    static uint32_t compute(const void* data, size_t length, uint32_t crc = 0) 
+	{
+        static const vector<uint32_t> table = buildTable();
+        const unsigned char* bytes = (const unsigned char*)data;
+        crc = ~crc;
+        for (size_t i = 0; i < length; ++i) 
+		{
+            crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+private:
+    static vector<uint32_t> buildTable() 
+	{
+        vector<uint32_t> table(256);
+        for (uint32_t i = 0; i < 256; ++i) 
+		{
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) 
+			{
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+};
+
+// menu.bin layout: header, fixed-size item table, then one blob holding every string.
+// Integers are stored in host (little-endian) order.
+struct MenuImageHeader 
+{
+    char magic[8];        // "PSMENU"
+    uint32_t version;
+    uint32_t itemCount;
+    uint64_t blobSize;
+    uint64_t sourceSize;  // size and write time of the menu.txt the image was built from
+    int64_t sourceTime;
+    uint32_t checksum;    // CRC-32C of the item table and blob
+    uint32_t reserved;
+};
+
+struct MenuImageItem 
+{
+    uint32_t codeOffset;
+    uint32_t nameOffset;
+    uint32_t categoryOffset;
+    uint16_t codeLength;
+    uint16_t nameLength;
+    uint16_t categoryLength;
+    uint16_t reserved;
+    uint32_t padding;
+    int64_t priceCents;
+};
+
+static_assert(sizeof(MenuImageHeader) == 48, "menu.bin header layout changed");
+static_assert(sizeof(MenuImageItem) == 32, "menu.bin item layout changed");
+
+// Binary snapshot of the menu written next to menu.txt. Loading it is a bounds
+// check and a checksum over a read-only mapping, with no text to parse. The
+// loaded items point into the mapping, which the catalog keeps open, so every
+// kiosk on the host reads the same physical copy of the menu's strings.
+class MenuImage 
+{
+public:
+    static const uint32_t VERSION = 2;  // 2: prices stored as integer sen
+
+    static bool write(const string& path, const string& sourcePath, const vector<MenuItem>& items) 
+	{
+        MenuImageHeader header = {};
+        memcpy(header.magic, "PSMENU", 6);
+        header.version = VERSION;
+        header.itemCount = (uint32_t)items.size();
+        if (!sourceStamp(sourcePath, header.sourceSize, header.sourceTime)) 
+		{
+            return false;
+        }
+
+        vector<MenuImageItem> table(items.size());
+        string blob;
+        for (size_t i = 0; i < items.size(); ++i) 
+		{
+            MenuImageItem& entry = table[i];
+            entry = {};
+            if (!appendString(blob, items[i].code, entry.codeOffset, entry.codeLength) ||
+                !appendString(blob, items[i].name, entry.nameOffset, entry.nameLength) ||
+                !appendString(blob, items[i].category, entry.categoryOffset, entry.categoryLength)) 
+			{
+                return false;
+            }
+            entry.priceCents = items[i].price.cents;
+        }
+        header.blobSize = blob.size();
+
+        size_t tableBytes = table.size() * sizeof(MenuImageItem);
+        header.checksum = Crc32c::compute(table.data(), tableBytes);
+        header.checksum = Crc32c::compute(blob.data(), blob.size(), header.checksum);
+
+        // Write a temporary file and rename it, so a process loading the old image never sees a torn one
+        string tempPath = path + ".tmp";
+        {
+            ofstream out(tempPath, ios::binary | ios::trunc);
+            if (!out) 
+			{
+                return false;
+            }
+            out.write((const char*)&header, sizeof(header));
+            out.write((const char*)table.data(), tableBytes);
+            out.write(blob.data(), blob.size());
+            if (!out) 
+			{
+                return false;
+            }
+        }
+
+        error_code ec;
+        filesystem::rename(tempPath, path, ec);
+        if (ec) 
+		{
+            filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    // Returns false when there is no usable image. error stays empty when the image
+    // is simply missing or older than menu.txt, and is set when the file is damaged.
+    // The items point into file, which must stay open while they are used.
+    static bool load(const string& path, const string& sourcePath, MappedFile& file, vector<MenuItem>& items, string& error) 
+	{
+        if (!file.open(path)) 
+		{
+            return false;
+        }
+
+        if (file.size() < sizeof(MenuImageHeader)) 
+		{
+            error = "file is truncated";
+            return false;
+        }
+        MenuImageHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        if (memcmp(header.magic, "PSMENU", 6) != 0) 
+		{
+            error = "not a menu image";
+            return false;
+        }
+        if (header.version != VERSION) 
+		{
+            error = "unsupported version " + to_string(header.version);
+            return false;
+        }
+
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        if (!sourceStamp(sourcePath, sourceSize, sourceTime) || sourceSize != header.sourceSize || sourceTime != header.sourceTime) 
+		{
+            return false;  // menu.txt changed since the image was written
+        }
+
+        uint64_t tableBytes = (uint64_t)header.itemCount * sizeof(MenuImageItem);
+        if (sizeof(header) + tableBytes + header.blobSize != file.size()) 
+		{
+            error = "size does not match header";
+            return false;
+        }
+
+        const char* tableStart = file.data() + sizeof(header);
+        const char* blob = tableStart + tableBytes;
+        uint32_t checksum = Crc32c::compute(tableStart, tableBytes + header.blobSize);
+        if (checksum != header.checksum) 
+		{
+            error = "checksum mismatch";
+            return false;
+        }
+
+        items.clear();
+        items.reserve(header.itemCount);
+        for (uint32_t i = 0; i < header.itemCount; ++i) 
+		{
+            MenuImageItem entry;
+            memcpy(&entry, tableStart + i * sizeof(MenuImageItem), sizeof(entry));
+            if (!inBlob(entry.codeOffset, entry.codeLength, header.blobSize) ||
+                !inBlob(entry.nameOffset, entry.nameLength, header.blobSize) ||
+                !inBlob(entry.categoryOffset, entry.categoryLength, header.blobSize)) 
+			{
+                items.clear();
+                error = "item " + to_string(i) + " points outside the string blob";
+                return false;
+            }
+
+            MenuItem item;
+            item.code = string_view(blob + entry.codeOffset, entry.codeLength);
+            item.name = string_view(blob + entry.nameOffset, entry.nameLength);
+            item.category = string_view(blob + entry.categoryOffset, entry.categoryLength);
+            item.price = Money(entry.priceCents);
+            items.push_back(item);
+        }
+        return true;
+    }
+
+private:
+    static bool sourceStamp(const string& path, uint64_t& size, int64_t& time) 
+	{
+        error_code ec;
+        size = filesystem::file_size(path, ec);
+        if (ec) 
+		{
+            return false;
+        }
+        time = (int64_t)filesystem::last_write_time(path, ec).time_since_epoch().count();
+        return !ec;
+    }
+
+    static bool appendString(string& blob, string_view value, uint32_t& offset, uint16_t& length) 
+	{
+        if (value.size() > 0xFFFF || blob.size() + value.size() > 0xFFFFFFFFu) 
+		{
+            return false;
+        }
+        offset = (uint32_t)blob.size();
+        length = (uint16_t)value.size();
+        blob += value;
+        return true;
+    }
+
+    static bool inBlob(uint32_t offset, uint16_t length, uint64_t blobSize) 
+	{
+        return (uint64_t)offset + length <= blobSize;
+    }
+};
+
+struct OrderLogHeader 
+{
+    char magic[8];         // "PSORDLOG"
+    uint32_t version;
+    uint32_t recordSize;   // bytes of one checkout line
+    int64_t createdAt;
+    uint32_t reserved;
+    uint32_t checksum;     // CRC-32C of the fields above
+};
+
+// Starts every frame. Frames are padded to a multiple of 8 bytes so the
+// checkout records inside a mapping are always 8-byte aligned.
+struct OrderLogFrame 
+{
+    uint32_t checksum;     // CRC-32C of type, length and payload
+    uint16_t type;
+    uint16_t length;       // payload bytes, not counting padding
+};
+
+// Payload of a checkout frame, followed by lineCount OrderLogLine records
+struct OrderLogCheckout 
+{
+    uint64_t orderId;
+    int64_t orderTime;     // seconds since the epoch
+    int64_t totalCents;
+    uint32_t customerId;   // ids given by string frames earlier in the log
+    uint32_t dineId;
+    uint32_t lineCount;
+    uint32_t reserved;
+};
+
+struct OrderLogLine 
+{
+    int64_t priceCents;    // unit price
+    uint32_t itemId;       // packed menu code, 0 when unknown
+    uint32_t itemNameId;
+    int32_t quantity;
+    uint32_t reserved;
+};
+
+// Payload of a segment frame, which starts every segment after the first
+struct OrderLogSegmentStart 
+{
+    int64_t day;             // local day number the segment was opened for
+    uint32_t firstStringId;  // string ids restart their definitions here
+    uint32_t reserved;
+};
+
+// Bloom filter over the names used in one segment. 4096 bits and 5 probes keep
+// false positives near 1% up to about 400 distinct names; a fuller segment just
+// gets skipped less often.
+struct NameFilter 
+{
+    static const uint32_t BITS = 4096;
+    static const int PROBES = 5;
+
+    uint64_t words[BITS / 64];
+
+    void add(string_view name) 
+	{
+        uint32_t h1, h2;
+        hashes(name, h1, h2);
+        for (int i = 0; i < PROBES; ++i, h1 += h2) 
+		{
+            words[(h1 % BITS) / 64] |= uint64_t(1) << (h1 % 64);
+        }
+    }
+
+    bool mayContain(string_view name) const 
+	{
+        uint32_t h1, h2;
+        hashes(name, h1, h2);
+        for (int i = 0; i < PROBES; ++i, h1 += h2) 
+		{
+            if (!(words[(h1 % BITS) / 64] & (uint64_t(1) << (h1 % 64)))) 
+			{
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    // Stored on disk, so the hash must not depend on the standard library
+    static void hashes(string_view name, uint32_t& h1, uint32_t& h2) 
+	{
+        h1 = Crc32c::compute(name.data(), name.size());
+        h2 = Crc32c::compute(name.data(), name.size(), 0x9E3779B9u) | 1;
+    }
+};
+
+// One segment of orders.log as listed in orders.manifest
+struct OrderSegment 
+{
+    int64_t firstTime;       // earliest and latest order time in the segment
+    int64_t lastTime;
+    uint64_t begin;          // byte range of the segment in orders.log
+    uint64_t end;
+    int64_t day;
+    uint32_t orderCount;
+    uint32_t firstStringId;
+    NameFilter customers;    // customer and item names ordered in the segment
+    NameFilter items;
+    uint32_t checksum;       // CRC-32C of the fields above
+    uint32_t reserved;
+};
+
+struct OrderManifestHeader 
+{
+    char magic[8];           // "PSSEGMAN"
+    uint32_t version;
+    uint32_t reserved;
+    int64_t logCreatedAt;    // createdAt of the orders.log the manifest describes
+};
+
+static_assert(sizeof(OrderLogHeader) == 32, "orders.log header layout changed");
+static_assert(sizeof(OrderLogFrame) == 8, "orders.log frame layout changed");
+static_assert(sizeof(OrderLogCheckout) == 40, "orders.log checkout layout changed");
+static_assert(sizeof(OrderLogLine) == 24, "orders.log line layout changed");
+static_assert(sizeof(OrderLogSegmentStart) == 16, "orders.log segment frame layout changed");
+static_assert(sizeof(OrderSegment) == 1080, "orders.manifest entry layout changed");
+static_assert(sizeof(OrderManifestHeader) == 24, "orders.manifest header layout changed");
+
+// One item of a checkout as seen through the mapping; the strings point into the file
+struct OrderLogEntry 
+{
+    const OrderLogCheckout* checkout;
+    const OrderLogLine* line;
+    uint32_t lineIndex;  // position of line within the checkout
+    uint64_t offset;     // where the checkout frame starts
+    string_view customerName;
+    string_view dineOption;
+    string_view foodDetails;
+};
+
+// orders.log is the append-only binary order history; orders.txt is kept for
+// people to read. After the header the log is a sequence of frames: a string
+// frame gives a customer, dine option or item name the next id the first time
+// it is written, and a checkout frame holds one OrderLogCheckout and its lines.
+//
+// The log is divided into segments, one per day or per MAX_SEGMENT_BYTES. Each
+// segment after the first opens with a segment frame and defines again every
+// string it uses, so any segment can be read on its own. orders.manifest lists
+// the sealed segments with their time range, order count and byte range.
+class OrderLog 
+{
+public:
+    static const uint32_t VERSION = 2;  // 2: checkout frames instead of one frame per item
+    static const uint16_t FRAME_STRING = 1;
+    static const uint16_t FRAME_SEGMENT = 3;
+    static const uint16_t FRAME_CHECKOUT = 4;  // 2 was the per-item frame of version 1
+    static const uint64_t MAX_SEGMENT_BYTES = 64u << 20;
+    // Lines that fit one frame; a bigger checkout continues in the next frame under the same id
+    static const uint32_t MAX_CHECKOUT_LINES = (0xFFFF - sizeof(OrderLogCheckout)) / sizeof(OrderLogLine);
+
+    // Days since 1970-01-01 of the local calendar date of when
+    static int64_t localDay(time_t when) 
+	{
+        tm fields;
+#ifdef _WIN32
+        localtime_s(&fields, &when);
+#else
+        localtime_r(&when, &fields);
+#endif
+        // days_from_civil (H. Hinnant)
+        int64_t year = fields.tm_year + 1900 - (fields.tm_mon < 2 ? 1 : 0);
+        int64_t era = (year >= 0 ? year : year - 399) / 400;
+        int64_t yearOfEra = year - era * 400;
+        int64_t month = fields.tm_mon + 1;
+        int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + fields.tm_mday - 1;
+        int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + dayOfEra - 719468;
+    }
+
+    static uint32_t segmentChecksum(const OrderSegment& segment) 
+	{
+        return Crc32c::compute(&segment, offsetof(OrderSegment, checksum));
+    }
+
+    static size_t frameSize(size_t payload) 
+	{
+        return (sizeof(OrderLogFrame) + payload + 7) & ~(size_t)7;
+    }
+
+    static OrderLogHeader makeHeader() 
+	{
+        OrderLogHeader header = {};
+        memcpy(header.magic, "PSORDLOG", 8);
+        header.version = VERSION;
+        header.recordSize = sizeof(OrderLogLine);
+        header.createdAt = (int64_t)time(nullptr);
+        header.checksum = Crc32c::compute(&header, offsetof(OrderLogHeader, checksum));
+        return header;
+    }
+
+    static uint32_t frameChecksum(uint16_t type, uint16_t length, const void* payload) 
+	{
+        uint16_t fields[2] = {type, length};
+        return Crc32c::compute(payload, length, Crc32c::compute(fields, sizeof(fields)));
+    }
+
+    static void appendFrame(string& out, uint16_t type, const void* payload, uint16_t length) 
+	{
+        OrderLogFrame frame;
+        frame.checksum = frameChecksum(type, length, payload);
+        frame.type = type;
+        frame.length = length;
+        size_t start = out.size();
+        out.append((const char*)&frame, sizeof(frame));
+        out.append((const char*)payload, length);
+        out.resize(start + frameSize(length), '\0');
+    }
+
+    // The frame at offset in a mapped log; false when it is out of bounds or
+    // fails its checksum
+    static bool frameAt(string_view log, uint64_t offset, uint16_t& type, const char*& payload, uint16_t& length) 
+	{
+        if (offset < sizeof(OrderLogHeader) || offset + sizeof(OrderLogFrame) > log.size()) 
+		{
+            return false;
+        }
+        OrderLogFrame frame;
+        memcpy(&frame, log.data() + offset, sizeof(frame));
+        const char* data = log.data() + offset + sizeof(OrderLogFrame);
+        if (offset + frameSize(frame.length) > log.size() || frameChecksum(frame.type, frame.length, data) != frame.checksum) 
+		{
+            return false;
+        }
+        type = frame.type;
+        payload = data;
+        length = frame.length;
+        return true;
+    }
+
+    // Payload of the frame at offset in a mapped log, or nullptr when the frame is
+    // out of bounds, of another type or fails its checksum
+    static const char* payloadAt(string_view log, uint64_t offset, uint16_t type, uint16_t& length) 
+	{
+        uint16_t actual;
+        const char* payload;
+        if (!frameAt(log, offset, actual, payload, length) || actual != type) 
+		{
+            return nullptr;
+        }
+        return payload;
+    }
+
+    // Text form of a timestamp, as ctime() prints it but without the newline.
+    // ctime() shares one buffer between threads, so the fields are formatted here.
+    static string timeText(time_t when) 
+	{
+        tm fields;
+#ifdef _WIN32
+        localtime_s(&fields, &when);
+#else
+        localtime_r(&when, &fields);
+#endif
+        char text[32];
+        size_t length = strftime(text, sizeof(text), "%a %b %e %H:%M:%S %Y", &fields);
+        return string(text, length);
+    }
+};
+
+// Monotonic storage for many small strings. Copies are packed into blocks that
+// are only ever freed together, so a bulk load costs one allocation per block
+// and tearing it down costs one free per block. Blocks start small and double,
+// so an arena holding a handful of names stays small too.
+class StringArena 
+{
+public:
+    static const size_t FIRST_BLOCK = 256;
+    static const size_t MAX_BLOCK = 64 * 1024;
+
+private:
+    vector<unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    size_t left = 0;
+    size_t nextBlock = FIRST_BLOCK;
+
+public:
+    // The copy stays valid, and never moves, until clear() or destruction
+    string_view store(string_view text) 
+	{
+        if (text.empty()) 
+		{
+            return string_view();
+        }
+        if (text.size() > left) 
+		{
+            size_t size = max(nextBlock, text.size());
+            blocks.emplace_back(new char[size]);
+            cursor = blocks.back().get();
+            left = size;
+            nextBlock = min(nextBlock * 2, size_t(MAX_BLOCK));
+        }
+        memcpy(cursor, text.data(), text.size());
+        string_view stored(cursor, text.size());
+        cursor += text.size();
+        left -= text.size();
+        return stored;
+    }
+
+    size_t blockCount() const { return blocks.size(); }
+
+    void clear() 
+	{
+        blocks.clear();
+        cursor = nullptr;
+        left = 0;
+        nextBlock = FIRST_BLOCK;
+    }
+};
+
+// The distinct names of a loaded history, each stored once in an arena under a 32-bit id
+class NameDictionary 
+{
+private:
+    StringArena text;
+    vector<string_view> names;
+    unordered_map<string_view, uint32_t> ids;
+
+public:
+    uint32_t intern(string_view name) 
+	{
+        auto it = ids.find(name);
+        if (it != ids.end()) 
+		{
+            return it->second;
+        }
+        uint32_t id = (uint32_t)names.size();
+        names.push_back(text.store(name));
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    // False when the name does not occur, so nothing can match it
+    bool find(string_view name, uint32_t& id) const 
+	{
+        auto it = ids.find(name);
+        if (it == ids.end()) 
+		{
+            return false;
+        }
+        id = it->second;
+        return true;
+    }
+
+    string_view name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+    void clear() 
+	{
+        ids.clear();
+        names.clear();
+        text.clear();
+    }
+};
+
+// One orders.txt line, with the text fields pointing into the line itself
+struct OrderTextRow 
+{
+    string_view customerName;
+    string_view dineOption;
+    string_view foodDetails;
+    string_view orderTime;
+    int quantity = 0;
+    Money price;
+    time_t parsedOrderTime = 0;
+};
+
+// Order history as checkouts and their items. The customer, dine option and
+// time are kept once per checkout instead of once per item, and every name is
+// kept once in the dictionary, so rows compare and group by integer id.
+struct OrderBook 
+{
+    vector<OrderHeader> orders;
+    vector<OrderLine> lines;
+    NameDictionary names;
+
+    void clear() 
+	{
+        orders.clear();
+        lines.clear();
+        names.clear();
+    }
+
+    string_view customerOf(const OrderHeader& header) const { return names.name(header.customerId); }
+    string_view dineOptionOf(const OrderHeader& header) const { return names.name(header.dineId); }
+    string_view foodOf(const OrderLine& line) const { return names.name(line.foodId); }
+
+    // Starts a checkout; addLine() then fills it
+    OrderHeader& addOrder(uint64_t orderId, string_view customerName, string_view dineOption, time_t orderTime) 
+	{
+        OrderHeader header;
+        header.orderId = orderId;
+        header.customerId = names.intern(customerName);
+        header.dineId = names.intern(dineOption);
+        header.orderTime = orderTime;
+        header.firstLine = (uint32_t)lines.size();
+        orders.push_back(header);
+        return orders.back();
+    }
+
+    void addLine(string_view foodDetails, uint32_t itemId, int quantity, Money price) 
+	{
+        OrderLine line;
+        line.foodId = names.intern(foodDetails);
+        line.itemId = itemId;
+        line.quantity = quantity;
+        line.price = price;
+        OrderHeader& header = orders.back();
+        header.total += quantity * price;
+        header.lineCount++;
+        lines.push_back(line);
+    }
+
+    // Adds an orders.txt row. Consecutive rows with the same customer, dine option
+    // and time make up one checkout, since orders.txt has no order ids.
+    void addRow(const OrderTextRow& row) 
+	{
+        uint32_t customerId = names.intern(row.customerName);
+        uint32_t dineId = names.intern(row.dineOption);
+        if (orders.empty() || orders.back().orderTime != row.parsedOrderTime ||
+            orders.back().customerId != customerId || orders.back().dineId != dineId) 
+		{
+            addOrder(0, row.customerName, row.dineOption, row.parsedOrderTime);
+        }
+        addLine(row.foodDetails, 0, row.quantity, row.price);
+    }
+
+    // Appends other, whose ids are translated into this dictionary. A first
+    // checkout that continues the last one here is merged into it.
+    void append(OrderBook& other) 
+	{
+        vector<uint32_t> translate(other.names.size());
+        for (uint32_t id = 0; id < translate.size(); ++id) 
+		{
+            translate[id] = names.intern(other.names.name(id));
+        }
+        uint32_t lineBase = (uint32_t)lines.size();
+        for (size_t i = 0; i < other.orders.size(); ++i) 
+		{
+            OrderHeader header = other.orders[i];
+            header.customerId = translate[header.customerId];
+            header.dineId = translate[header.dineId];
+            header.firstLine += lineBase;
+            if (i == 0 && !orders.empty() && orders.back().orderTime == header.orderTime &&
+                orders.back().customerId == header.customerId && orders.back().dineId == header.dineId) 
+			{
+                orders.back().lineCount += header.lineCount;
+                orders.back().total += header.total;
+                continue;
+            }
+            orders.push_back(header);
+        }
+        for (OrderLine line : other.lines) 
+		{
+            line.foodId = translate[line.foodId];
+            lines.push_back(line);
+        }
+    }
+
+    // Appends the rows of the items keep(header, line) accepts. Callers look their
+    // key up in the dictionary once, so keep() compares ids rather than strings.
+    template <class Keep>
+    void select(Keep keep, vector<Order>& rows) const 
+	{
+        for (const OrderHeader& header : orders) 
+		{
+            for (uint32_t i = 0; i < header.lineCount; ++i) 
+			{
+                if (keep(header, lines[header.firstLine + i])) 
+				{
+                    rows.push_back(row(header, i));
+                }
+            }
+        }
+    }
+
+    // The flat per-item row that exports and sorts work with
+    Order row(const OrderHeader& header, uint32_t index) const 
+	{
+        Order order;
+        row(header, index, order);
+        return order;
+    }
+
+    // Overwrites order in place, reusing the storage of its strings. The time
+    // text is only reformatted when the time differs from the row overwritten.
+    void row(const OrderHeader& header, uint32_t index, Order& order) const 
+	{
+        const OrderLine& line = lines[header.firstLine + index];
+        string_view customer = customerOf(header), dine = dineOptionOf(header), food = foodOf(line);
+        order.customerName.assign(customer.data(), customer.size());
+        order.dineOption.assign(dine.data(), dine.size());
+        order.foodDetails.assign(food.data(), food.size());
+        order.quantity = line.quantity;
+        order.price = line.price;
+        if (order.orderTime.empty() || order.parsedOrderTime != header.orderTime) 
+		{
+            order.orderTime = OrderLog::timeText(header.orderTime);
+        }
+        order.parsedOrderTime = header.orderTime;
+        order.totalPrice = line.quantity * line.price;
+        order.itemId = line.itemId;
+        order.orderId = header.orderId;
+    }
+};
+
+// Walks orders.log over a read-only mapping without copying records out of it
+class OrderLogReader 
+{
+private:
+    MappedFile file;
+    OrderLogHeader logHeader = {};
+    vector<string_view> strings;  // indexed by id - firstId
+    vector<uint64_t> stringFrames;  // offset of the frame defining each string
+    uint32_t firstId = 0;
+    size_t offset = 0;
+    size_t limit = 0;
+    size_t lastFrame = 0;
+    uint64_t frames = 0;
+    vector<OrderSegment> segmentList;
+    const OrderLogCheckout* checkout = nullptr;  // the checkout whose lines next() is handing out
+    uint32_t checkoutLine = 0;
+    uint64_t checkoutOffset = 0;
+    bool truncated = false;
+    uint32_t olderVersion = 0;
+    string failure;
+
+public:
+    // Returns false when there is no log. error is set when the file exists but
+    // its header is damaged.
+    bool open(const string& path, string& error) 
+	{
+        strings.clear();
+        stringFrames.clear();
+        segmentList.clear();
+        checkout = nullptr;
+        firstId = 0;
+        frames = 0;
+        lastFrame = 0;
+        truncated = false;
+        olderVersion = 0;
+        failure.clear();
+        if (!file.open(path)) 
+		{
+            return false;
+        }
+        if (file.size() < sizeof(OrderLogHeader)) 
+		{
+            error = "header is truncated";
+            truncated = true;
+            return false;
+        }
+        OrderLogHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        if (memcmp(header.magic, "PSORDLOG", 8) != 0) 
+		{
+            error = "not an order log";
+            return false;
+        }
+        if (header.checksum != Crc32c::compute(&header, offsetof(OrderLogHeader, checksum))) 
+		{
+            error = "header checksum mismatch";
+            return false;
+        }
+        if (header.version != OrderLog::VERSION || header.recordSize != sizeof(OrderLogLine)) 
+		{
+            error = "unsupported version " + to_string(header.version);
+            olderVersion = header.version < OrderLog::VERSION ? header.version : 0;
+            return false;
+        }
+        logHeader = header;
+        offset = sizeof(OrderLogHeader);
+        limit = file.size();
+        return true;
+    }
+
+    // Reads only the segment in [begin, end) of the log
+    bool openSegment(const string& path, uint64_t begin, uint64_t end, string& error) 
+	{
+        if (!open(path, error)) 
+		{
+            return false;
+        }
+        if (begin < sizeof(OrderLogHeader) || begin > end || end > file.size()) 
+		{
+            error = "segment lies outside the log";
+            return false;
+        }
+        offset = (size_t)begin;
+        limit = (size_t)end;
+        return true;
+    }
+
+    // Moves to the next item of the current checkout, or to the first item of
+    // the next one. Returns false at the end of the log, or at the first frame
+    // that is cut short or fails its checksum (see error()).
+    bool next(OrderLogEntry& entry) 
+	{
+        if (checkout && checkoutLine < checkout->lineCount) 
+		{
+            return lineEntry(entry);
+        }
+        checkout = nullptr;
+        const char* base = file.data();
+        while (failure.empty() && offset < limit) 
+		{
+            if (limit - offset < sizeof(OrderLogFrame)) 
+			{
+                return stop("frame header is truncated", true);
+            }
+            const OrderLogFrame* frame = (const OrderLogFrame*)(base + offset);
+            size_t size = OrderLog::frameSize(frame->length);
+            if (limit - offset < size) 
+			{
+                return stop("frame is truncated", true);
+            }
+            const char* payload = base + offset + sizeof(OrderLogFrame);
+            if (OrderLog::frameChecksum(frame->type, frame->length, payload) != frame->checksum) 
+			{
+                return stop("checksum mismatch", false);
+            }
+
+            if (frame->type == OrderLog::FRAME_STRING) 
+			{
+                uint32_t id;
+                if (frame->length < sizeof(id)) 
+				{
+                    return stop("string frame is too short", false);
+                }
+                memcpy(&id, payload, sizeof(id));
+                if (id != firstId + strings.size()) 
+				{
+                    return stop("string id out of sequence", false);
+                }
+                strings.push_back(string_view(payload + sizeof(id), frame->length - sizeof(id)));
+                stringFrames.push_back(offset);
+                lastFrame = offset;
+                ++frames;
+                offset += size;
+                extendSegment();
+                continue;
+            }
+            if (frame->type == OrderLog::FRAME_SEGMENT && frame->length == sizeof(OrderLogSegmentStart)) 
+			{
+                OrderLogSegmentStart start;
+                memcpy(&start, payload, sizeof(start));
+                if (strings.empty()) 
+				{
+                    firstId = start.firstStringId;  // reading this segment on its own
+                }
+                if (start.firstStringId != firstId + strings.size()) 
+				{
+                    return stop("segment starts at the wrong string id", false);
+                }
+                OrderSegment segment = {};
+                segment.begin = offset;
+                segment.day = start.day;
+                segment.firstStringId = start.firstStringId;
+                segmentList.push_back(segment);
+                offset += size;
+                extendSegment();
+                continue;
+            }
+            if (frame->type != OrderLog::FRAME_CHECKOUT) 
+			{
+                return stop("unknown frame type " + to_string(frame->type), false);
+            }
+
+            const OrderLogCheckout* record = (const OrderLogCheckout*)payload;
+            if (frame->length < sizeof(OrderLogCheckout) || record->lineCount == 0 ||
+                frame->length != sizeof(OrderLogCheckout) + (size_t)record->lineCount * sizeof(OrderLogLine)) 
+			{
+                return stop("checkout has the wrong size", false);
+            }
+            if (!known(record->customerId) || !known(record->dineId)) 
+			{
+                return stop("checkout refers to an unknown string", false);
+            }
+            const OrderLogLine* lines = (const OrderLogLine*)(record + 1);
+            for (uint32_t i = 0; i < record->lineCount; ++i) 
+			{
+                if (!known(lines[i].itemNameId)) 
+				{
+                    return stop("checkout refers to an unknown string", false);
+                }
+            }
+            checkout = record;
+            checkoutLine = 0;
+            checkoutOffset = offset;
+            lastFrame = offset;
+            ++frames;
+            offset += size;
+            countOrder(record->orderTime);
+            return lineEntry(entry);
+        }
+        return false;
+    }
+
+    static Order toOrder(const OrderLogEntry& entry) 
+	{
+        Order order;
+        toOrder(entry, order);
+        return order;
+    }
+
+    // Overwrites order in place like OrderBook::row(), so streaming the log
+    // does not allocate per row
+    static void toOrder(const OrderLogEntry& entry, Order& order) 
+	{
+        const OrderLogCheckout& checkout = *entry.checkout;
+        const OrderLogLine& line = *entry.line;
+        order.customerName.assign(entry.customerName.data(), entry.customerName.size());
+        order.dineOption.assign(entry.dineOption.data(), entry.dineOption.size());
+        order.foodDetails.assign(entry.foodDetails.data(), entry.foodDetails.size());
+        order.quantity = line.quantity;
+        order.price = Money(line.priceCents);
+        if (order.orderTime.empty() || order.parsedOrderTime != (time_t)checkout.orderTime) 
+		{
+            order.orderTime = OrderLog::timeText((time_t)checkout.orderTime);
+        }
+        order.parsedOrderTime = (time_t)checkout.orderTime;
+        order.totalPrice = order.quantity * order.price;
+        order.itemId = line.itemId;
+        order.orderId = checkout.orderId;
+    }
+
+    // Adds the entry to book, starting a checkout on its first item
+    static void addTo(OrderBook& book, const OrderLogEntry& entry) 
+	{
+        const OrderLogCheckout& checkout = *entry.checkout;
+        const OrderLogLine& record = *entry.line;
+        if (entry.lineIndex == 0 && (book.orders.empty() || book.orders.back().orderId != checkout.orderId)) 
+		{
+            book.addOrder(checkout.orderId, entry.customerName, entry.dineOption, (time_t)checkout.orderTime);
+        }
+        book.addLine(entry.foodDetails, record.itemId, record.quantity, Money(record.priceCents));
+    }
+
+    // End of the last good frame
+    size_t position() const { return offset; }
+    // Start of the last good frame, and how many good frames there are up to it
+    size_t lastFrameOffset() const { return lastFrame; }
+    uint64_t frameCount() const { return frames; }
+    const OrderLogHeader& header() const { return logHeader; }
+    size_t fileSize() const { return file.size(); }
+    const vector<uint64_t>& stringFrameOffsets() const { return stringFrames; }
+    // Segments seen so far, ending at position(); after a full scan the last one is still open
+    const vector<OrderSegment>& segments() const { return segmentList; }
+    // Id of dictionary()[0]; zero unless reading a single segment
+    uint32_t firstStringId() const { return firstId; }
+    // True when reading stopped at a frame cut short by an interrupted append
+    bool isTruncated() const { return truncated; }
+    // Version of a sound log that open() refused for being older, otherwise 0
+    uint32_t olderLogVersion() const { return olderVersion; }
+    void close() { file.close(); }
+    const string& error() const { return failure; }
+    const vector<string_view>& dictionary() const { return strings; }
+
+private:
+    bool stop(const string& message, bool torn) 
+	{
+        failure = message + " at offset " + to_string(offset);
+        truncated = torn;
+        return false;
+    }
+
+    bool known(uint32_t id) const 
+	{
+        return id >= firstId && id - firstId < strings.size();
+    }
+
+    bool lineEntry(OrderLogEntry& entry) 
+	{
+        const OrderLogLine* line = (const OrderLogLine*)(checkout + 1) + checkoutLine;
+        entry.checkout = checkout;
+        entry.line = line;
+        entry.lineIndex = checkoutLine++;
+        entry.offset = checkoutOffset;
+        entry.customerName = strings[checkout->customerId - firstId];
+        entry.dineOption = strings[checkout->dineId - firstId];
+        entry.foodDetails = strings[line->itemNameId - firstId];
+        return true;
+    }
+
+    void extendSegment() 
+	{
+        if (!segmentList.empty()) 
+		{
+            segmentList.back().end = offset;
+        }
+    }
+
+    // The first segment has no segment frame; it starts with the first order seen
+    void countOrder(int64_t orderTime) 
+	{
+        if (segmentList.empty()) 
+		{
+            OrderSegment segment = {};
+            segment.begin = sizeof(OrderLogHeader);
+            segment.day = OrderLog::localDay((time_t)orderTime);
+            segment.firstStringId = firstId;
+            segmentList.push_back(segment);
+        }
+        OrderSegment& segment = segmentList.back();
+        segment.firstTime = segment.orderCount == 0 ? orderTime : min(segment.firstTime, orderTime);
+        segment.lastTime = segment.orderCount == 0 ? orderTime : max(segment.lastTime, orderTime);
+        segment.orderCount++;
+        segment.end = offset;
+    }
+};
+
+struct CustomerIndexHeader 
+{
+    char magic[8];          // "PSCUSTIX"
+    uint32_t version;
+    uint32_t reserved;
+    int64_t logCreatedAt;   // createdAt of the orders.log this index belongs to
+};
+
+struct CustomerIndexEntry 
+{
+    uint64_t logOffset;     // frame in orders.log
+    uint32_t id;            // string id; for an order entry, the customer's
+    uint32_t previous;      // the customer's previous order entry, or a marker
+};
+
+static_assert(sizeof(CustomerIndexHeader) == 24, "customers.idx header layout changed");
+static_assert(sizeof(CustomerIndexEntry) == 16, "customers.idx entry layout changed");
+
+// customers.idx: an on-disk index from customer name to that customer's checkouts
+// in orders.log, appended in step with the log. A string entry records where the
+// log defines a string id; an order entry points at a checkout frame and links
+// back to the same customer's previous order entry, so a customer's checkouts
+// form a chain that is walked in O(checkouts). Memory holds only the head of each
+// chain and the frame offsets of the most recently searched customers.
+//
+// The writer thread stages and commits entries; find() may run on any thread.
+class CustomerIndex 
+{
+public:
+    static const uint32_t VERSION = 2;  // 2: entries point at checkout frames
+    static const uint32_t NO_PREVIOUS = 0xFFFFFFFF;
+    static const uint32_t STRING_ENTRY = 0xFFFFFFFE;
+    static const size_t HOT_CUSTOMERS = 32;
+
+private:
+    struct Staged 
+	{
+        CustomerIndexEntry entry;
+        string customer;  // empty for string entries
+    };
+
+    mutex lock;
+    string indexPath;
+    string logPath;
+    AppendFile file;
+    MappedFile indexMap;
+    MappedFile logMap;
+    bool ready = false;
+    uint32_t entryCount = 0;
+    uint64_t logEnd = 0;                     // log bytes covered by committed entries
+    unordered_map<string, uint32_t> heads;   // customer -> newest order entry
+    vector<uint64_t> stringOffsets;          // string id -> defining frame
+    vector<Staged> staged;                   // written by the writer thread only
+
+    // Hot customers: their checkout offsets, oldest first, in least recently searched order
+    list<string> recent;
+    unordered_map<string, pair<vector<uint64_t>, list<string>::iterator>> hot;
+
+public:
+    // Loads the index for the log whose scan found frameCount frames, the last
+    // one at lastFrame, ending at end. A missing or stale index is rebuilt from
+    // the log. Returns false when neither works; find() then reports that.
+    bool open(const string& path, const string& orderLogPath, int64_t logCreatedAt, uint64_t frameCount, uint64_t lastFrame, uint64_t end) 
+	{
+        lock_guard<mutex> guard(lock);
+        reset();
+        indexPath = path;
+        logPath = orderLogPath;
+        logEnd = end;
+        if (!logMap.open(logPath)) 
+		{
+            return false;
+        }
+        if (!load(logCreatedAt, frameCount, lastFrame)) 
+		{
+            reset();
+            if (!rebuild(logCreatedAt) || !logMap.open(logPath) || !load(logCreatedAt, frameCount, lastFrame)) 
+			{
+                reset();
+                return false;
+            }
+        }
+        if (!file.open(indexPath)) 
+		{
+            reset();
+            return false;
+        }
+        ready = true;
+        return true;
+    }
+
+    void close() 
+	{
+        lock_guard<mutex> guard(lock);
+        reset();
+    }
+
+    // Called by the log while it encodes frames that are not written yet
+    void stageString(uint32_t id, uint64_t offset) 
+	{
+        staged.push_back({{offset, id, STRING_ENTRY}, string()});
+    }
+
+    void stageOrder(string_view customer, uint32_t customerId, uint64_t offset) 
+	{
+        staged.push_back({{offset, customerId, NO_PREVIOUS}, string(customer)});
+    }
+
+    void discardStaged() { staged.clear(); }
+
+    // Called once the staged frames are in the log, which now ends at end
+    void commit(uint64_t end) 
+	{
+        lock_guard<mutex> guard(lock);
+        if (!ready) 
+		{
+            staged.clear();
+            return;
+        }
+
+        string bytes;
+        bytes.reserve(staged.size() * sizeof(CustomerIndexEntry));
+        uint32_t index = link(&bytes);
+        if (!file.write(bytes.data(), bytes.size())) 
+		{
+            cerr << indexPath << ": write failed, customer search will scan the history" << endl;
+            reset();
+            return;
+        }
+        entryCount = index;
+        logEnd = end;
+    }
+
+    // Like commit(), for frames another process appended to the log. It wrote
+    // their entries itself, so they are only taken in here, and only if the
+    // index file really has them.
+    void follow(uint64_t end) 
+	{
+        lock_guard<mutex> guard(lock);
+        if (!ready) 
+		{
+            staged.clear();
+            return;
+        }
+
+        error_code ec;
+        uint64_t expected = sizeof(CustomerIndexHeader) + (uint64_t)(entryCount + staged.size()) * sizeof(CustomerIndexEntry);
+        if (filesystem::file_size(indexPath, ec) != expected || ec) 
+		{
+            cerr << indexPath << ": out of step with the log, customer search will scan the history" << endl;
+            reset();
+            return;
+        }
+        entryCount = link(nullptr);
+        logEnd = end;
+    }
+
+    // Fills rows with every item the customer ordered, oldest first. Returns
+    // false when the index is unavailable or disagrees with the log.
+    bool find(const string& customer, vector<Order>& rows) 
+	{
+        lock_guard<mutex> guard(lock);
+        rows.clear();
+        if (!ready) 
+		{
+            return false;
+        }
+        auto head = heads.find(customer);
+        if (head == heads.end()) 
+		{
+            return true;
+        }
+
+        const vector<uint64_t>* offsets;
+        auto cached = hot.find(customer);
+        if (cached != hot.end()) 
+		{
+            recent.splice(recent.begin(), recent, cached->second.second);
+            offsets = &cached->second.first;
+        }
+        else 
+		{
+            vector<uint64_t> chain;
+            if (!walk(head->second, chain)) 
+			{
+                return false;
+            }
+            offsets = &remember(customer, move(chain));
+        }
+
+        if (logMap.size() < logEnd && !logMap.open(logPath)) 
+		{
+            return false;
+        }
+        rows.reserve(offsets->size());
+        for (uint64_t offset : *offsets) 
+		{
+            uint16_t length;
+            const char* payload = OrderLog::payloadAt(logMap.view(), offset, OrderLog::FRAME_CHECKOUT, length);
+            const OrderLogCheckout* checkout = (const OrderLogCheckout*)payload;
+            if (!payload || length < sizeof(OrderLogCheckout) ||
+                length != sizeof(OrderLogCheckout) + (size_t)checkout->lineCount * sizeof(OrderLogLine)) 
+			{
+                rows.clear();
+                return false;
+            }
+            OrderLogEntry entry;
+            entry.checkout = checkout;
+            entry.offset = offset;
+            if (!stringAt(checkout->customerId, entry.customerName) || !stringAt(checkout->dineId, entry.dineOption)) 
+			{
+                rows.clear();
+                return false;
+            }
+            const OrderLogLine* lines = (const OrderLogLine*)(checkout + 1);
+            for (uint32_t i = 0; i < checkout->lineCount; ++i) 
+			{
+                entry.line = &lines[i];
+                entry.lineIndex = i;
+                if (!stringAt(lines[i].itemNameId, entry.foodDetails)) 
+				{
+                    rows.clear();
+                    return false;
+                }
+                rows.push_back(OrderLogReader::toOrder(entry));
+            }
+        }
+        return true;
+    }
+
+private:
+    // Chains the staged entries onto their customers' lists and, when bytes is
+    // given, appends them there as they go to disk. Returns the new entry count.
+    uint32_t link(string* bytes) 
+	{
+        uint32_t index = entryCount;
+        for (Staged& item : staged) 
+		{
+            if (item.entry.previous == STRING_ENTRY) 
+			{
+                stringOffsets.push_back(item.entry.logOffset);
+            }
+            else 
+			{
+                auto head = heads.find(item.customer);
+                if (head != heads.end()) 
+				{
+                    item.entry.previous = head->second;
+                    head->second = index;
+                }
+                else 
+				{
+                    heads.emplace(item.customer, index);
+                }
+                auto cached = hot.find(item.customer);
+                if (cached != hot.end()) 
+				{
+                    cached->second.first.push_back(item.entry.logOffset);
+                }
+            }
+            if (bytes) 
+			{
+                bytes->append((const char*)&item.entry, sizeof(item.entry));
+            }
+            ++index;
+        }
+        staged.clear();
+        return index;
+    }
+
+    void reset() 
+	{
+        ready = false;
+        file.close();
+        indexMap.close();
+        logMap.close();
+        entryCount = 0;
+        heads.clear();
+        stringOffsets.clear();
+        staged.clear();
+        recent.clear();
+        hot.clear();
+    }
+
+    bool stringAt(uint32_t id, string_view& value) 
+	{
+        if (id >= stringOffsets.size()) 
+		{
+            return false;
+        }
+        uint16_t length;
+        const char* payload = OrderLog::payloadAt(logMap.view(), stringOffsets[id], OrderLog::FRAME_STRING, length);
+        if (!payload || length < sizeof(uint32_t)) 
+		{
+            return false;
+        }
+        value = string_view(payload + sizeof(uint32_t), length - sizeof(uint32_t));
+        return true;
+    }
+
+    // Follows one customer's chain back from its newest entry
+    bool walk(uint32_t index, vector<uint64_t>& chain) 
+	{
+        if (indexMap.size() < sizeof(CustomerIndexHeader) + (uint64_t)entryCount * sizeof(CustomerIndexEntry) && !indexMap.open(indexPath)) 
+		{
+            return false;
+        }
+        const char* entries = indexMap.data() + sizeof(CustomerIndexHeader);
+        while (index != NO_PREVIOUS) 
+		{
+            if (index >= entryCount) 
+			{
+                return false;
+            }
+            CustomerIndexEntry entry;
+            memcpy(&entry, entries + (size_t)index * sizeof(entry), sizeof(entry));
+            if (entry.previous != NO_PREVIOUS && entry.previous >= index) 
+			{
+                return false;  // links only ever point backwards
+            }
+            chain.push_back(entry.logOffset);
+            index = entry.previous;
+        }
+        reverse(chain.begin(), chain.end());
+        return true;
+    }
+
+    const vector<uint64_t>& remember(const string& customer, vector<uint64_t> chain) 
+	{
+        if (hot.size() >= HOT_CUSTOMERS) 
+		{
+            hot.erase(recent.back());
+            recent.pop_back();
+        }
+        recent.push_front(customer);
+        auto& slot = hot[customer];
+        slot.first = move(chain);
+        slot.second = recent.begin();
+        return slot.first;
+    }
+
+    // Accepts the index only if it covers exactly the frames the log scan found
+    bool load(int64_t logCreatedAt, uint64_t frameCount, uint64_t lastFrame) 
+	{
+        if (!indexMap.open(indexPath) || indexMap.size() < sizeof(CustomerIndexHeader)) 
+		{
+            return false;
+        }
+        CustomerIndexHeader header;
+        memcpy(&header, indexMap.data(), sizeof(header));
+        uint64_t bytes = indexMap.size() - sizeof(header);
+        if (memcmp(header.magic, "PSCUSTIX", 8) != 0 || header.version != VERSION ||
+            header.logCreatedAt != logCreatedAt || bytes % sizeof(CustomerIndexEntry) != 0 ||
+            bytes / sizeof(CustomerIndexEntry) != frameCount) 
+		{
+            return false;
+        }
+
+        entryCount = (uint32_t)frameCount;
+        uint64_t maxOffset = 0;
+        const char* entries = indexMap.data() + sizeof(header);
+        for (uint32_t i = 0; i < entryCount; ++i) 
+		{
+            CustomerIndexEntry entry;
+            memcpy(&entry, entries + (size_t)i * sizeof(entry), sizeof(entry));
+            maxOffset = max(maxOffset, entry.logOffset);
+            if (entry.previous == STRING_ENTRY) 
+			{
+                if (entry.id != stringOffsets.size()) 
+				{
+                    return false;
+                }
+                stringOffsets.push_back(entry.logOffset);
+                continue;
+            }
+            string_view customer;
+            if (!stringAt(entry.id, customer)) 
+			{
+                return false;
+            }
+            heads[string(customer)] = i;
+        }
+        return frameCount == 0 || maxOffset == lastFrame;
+    }
+
+    // Writes a fresh index from a full scan of the log
+    bool rebuild(int64_t logCreatedAt) 
+	{
+        vector<CustomerIndexEntry> orders;
+        vector<uint64_t> strings;
+        {
+            OrderLogReader reader;
+            string error;
+            if (!reader.open(logPath, error)) 
+			{
+                return false;
+            }
+            unordered_map<string_view, uint32_t> newest;
+            OrderLogEntry entry;
+            while (reader.next(entry)) 
+			{
+                if (entry.lineIndex != 0) 
+				{
+                    continue;
+                }
+                auto last = newest.find(entry.customerName);
+                uint32_t previous = last == newest.end() ? NO_PREVIOUS : last->second;
+                newest[entry.customerName] = (uint32_t)orders.size();
+                orders.push_back({entry.offset, entry.checkout->customerId, previous});
+            }
+            strings = reader.stringFrameOffsets();
+        }
+
+        // String entries go first, so order entry k ends up at strings.size() + k
+        CustomerIndexHeader header = {};
+        memcpy(header.magic, "PSCUSTIX", 8);
+        header.version = VERSION;
+        header.logCreatedAt = logCreatedAt;
+        string bytes((const char*)&header, sizeof(header));
+        for (uint32_t id = 0; id < strings.size(); ++id) 
+		{
+            CustomerIndexEntry entry = {strings[id], id, STRING_ENTRY};
+            bytes.append((const char*)&entry, sizeof(entry));
+        }
+        uint32_t base = (uint32_t)strings.size();
+        for (CustomerIndexEntry entry : orders) 
+		{
+            if (entry.previous != NO_PREVIOUS) 
+			{
+                entry.previous += base;
+            }
+            bytes.append((const char*)&entry, sizeof(entry));
+        }
+
+        string tempPath = indexPath + ".tmp";
+        {
+            ofstream out(tempPath, ios::binary | ios::trunc);
+            if (!out || !out.write(bytes.data(), bytes.size())) 
+			{
+                return false;
+            }
+        }
+        error_code ec;
+        filesystem::rename(tempPath, indexPath, ec);
+        if (ec) 
+		{
+            filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+};
+
+// orders.manifest: a header and one OrderSegment per sealed segment of orders.log,
+// appended by the order writer each time it rolls to a new segment
+class OrderManifest 
+{
+public:
+    static const uint32_t VERSION = 2;  // 2: name filters per segment
+
+    // False when the manifest is missing, belongs to another log or is damaged
+    static bool load(const string& path, int64_t logCreatedAt, vector<OrderSegment>& segments) 
+	{
+        segments.clear();
+        MappedFile file;
+        if (!file.open(path) || file.size() < sizeof(OrderManifestHeader)) 
+		{
+            return false;
+        }
+        OrderManifestHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        size_t bytes = file.size() - sizeof(header);
+        if (memcmp(header.magic, "PSSEGMAN", 8) != 0 || header.version != VERSION ||
+            header.logCreatedAt != logCreatedAt || bytes % sizeof(OrderSegment) != 0) 
+		{
+            return false;
+        }
+        segments.resize(bytes / sizeof(OrderSegment));
+        memcpy(segments.data(), file.data() + sizeof(header), bytes);
+        for (const OrderSegment& segment : segments) 
+		{
+            if (segment.checksum != OrderLog::segmentChecksum(segment)) 
+			{
+                segments.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool rewrite(const string& path, int64_t logCreatedAt, const vector<OrderSegment>& segments) 
+	{
+        OrderManifestHeader header = {};
+        memcpy(header.magic, "PSSEGMAN", 8);
+        header.version = VERSION;
+        header.logCreatedAt = logCreatedAt;
+
+        string tempPath = path + ".tmp";
+        {
+            ofstream out(tempPath, ios::binary | ios::trunc);
+            out.write((const char*)&header, sizeof(header));
+            for (OrderSegment segment : segments) 
+			{
+                segment.checksum = OrderLog::segmentChecksum(segment);
+                out.write((const char*)&segment, sizeof(segment));
+            }
+            if (!out) 
+			{
+                return false;
+            }
+        }
+        error_code ec;
+        filesystem::rename(tempPath, path, ec);
+        if (ec) 
+		{
+            filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    // Builds the name filters of a segment already in the log by reading it
+    static bool fillFilters(const string& logPath, OrderSegment& segment) 
+	{
+        segment.customers = {};
+        segment.items = {};
+        OrderLogReader reader;
+        string error;
+        if (!reader.openSegment(logPath, segment.begin, segment.end, error)) 
+		{
+            return false;
+        }
+        OrderLogEntry entry;
+        while (reader.next(entry)) 
+		{
+            segment.customers.add(entry.customerName);
+            segment.items.add(entry.foodDetails);
+        }
+        return reader.error().empty();
+    }
+
+    // Compares everything but the name filters, which a log scan does not build
+    static bool sameSegments(const vector<OrderSegment>& a, const vector<OrderSegment>& b) 
+	{
+        if (a.size() != b.size()) 
+		{
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) 
+		{
+            if (a[i].begin != b[i].begin || a[i].end != b[i].end || a[i].orderCount != b[i].orderCount ||
+                a[i].firstTime != b[i].firstTime || a[i].lastTime != b[i].lastTime || a[i].day != b[i].day ||
+                a[i].firstStringId != b[i].firstStringId) 
+			{
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Write side of orders.log. Only the order writer thread uses it. Several kiosk
+// processes can append to the same log: each one encodes and writes its frames
+// between lock() and unlock(), and lock() first reads whatever the others
+// appended, so string and order ids stay in one sequence.
+class OrderLogAppender 
+{
+private:
+    AppendFile file;
+    AppendFile manifest;
+    string logPath;
+    string manifestPath;
+    CustomerIndex customerIndex;
+    StringArena idText;
+    unordered_map<string_view, uint32_t> ids;  // strings defined in the current segment, kept in idText
+    vector<string_view> names;  // the same by id - current.firstStringId
+    uint32_t nextStringId = 0;
+    uint64_t nextOrderId = 1;
+    uint64_t end = 0;  // offset the next frame is written at
+    OrderSegment current = {};  // the open segment
+    vector<OrderSegment> sealed;  // rolled over but not yet in the manifest
+    bool fresh = false;
+
+public:
+    // Opens the log for appending, creating it if needed, along with its customer
+    // index and segment manifest. An append cut short by a crash is trimmed off;
+    // any other damage leaves the log closed with error set. A log written by an
+    // older version is set aside as <path>.v<version> and a new one started.
+    bool open(const string& path, const string& indexPath, const string& segmentManifestPath, string& error) 
+	{
+        close();
+        ids.clear();
+        names.clear();
+        idText.clear();
+        sealed.clear();
+        fresh = false;
+        logPath = path;
+        manifestPath = segmentManifestPath;
+        vector<OrderSegment> segments;
+
+        // Held until the log is scanned, trimmed and has a header, so a tail
+        // another kiosk is writing at the same moment is never taken for damage
+        if (!file.open(path) || !file.lock()) 
+		{
+            error = "cannot open for appending";
+            close();
+            return false;
+        }
+
+        size_t validEnd = 0;
+        int64_t createdAt = 0;
+        uint64_t frameCount = 0;
+        uint64_t lastFrame = 0;
+        nextOrderId = 1;
+        {
+            OrderLogReader reader;
+            string headerError;
+            if (reader.open(path, headerError)) 
+			{
+                OrderLogEntry entry;
+                while (reader.next(entry)) 
+				{
+                    nextOrderId = max(nextOrderId, entry.checkout->orderId + 1);
+                }
+                if (!reader.error().empty() && !reader.isTruncated()) 
+				{
+                    error = reader.error();
+                    close();
+                    return false;
+                }
+                segments = reader.segments();
+                uint32_t segmentStrings = segments.empty() ? 0 : segments.back().firstStringId;
+                const vector<string_view>& strings = reader.dictionary();
+                for (uint32_t id = segmentStrings; id < strings.size(); ++id) 
+				{
+                    string_view name = idText.store(strings[id]);
+                    ids.emplace(name, id);
+                    names.push_back(name);
+                }
+                nextStringId = (uint32_t)strings.size();
+                validEnd = reader.position();
+                createdAt = reader.header().createdAt;
+                frameCount = reader.frameCount();
+                lastFrame = reader.lastFrameOffset();
+            }
+            else if (reader.olderLogVersion() != 0) 
+			{
+                uint32_t version = reader.olderLogVersion();
+                reader.close();
+                file.close();
+                error_code ec;
+                filesystem::rename(path, path + ".v" + to_string(version), ec);
+                if (ec || !file.open(path) || !file.lock()) 
+				{
+                    error = "cannot set aside version " + to_string(version) + " log: " + ec.message();
+                    close();
+                    return false;
+                }
+            }
+            else if (!headerError.empty() && !reader.isTruncated()) 
+			{
+                error = headerError;
+                close();
+                return false;
+            }
+        }
+
+        error_code ec;
+        if (filesystem::exists(path, ec) && filesystem::file_size(path, ec) != validEnd) 
+		{
+            filesystem::resize_file(path, validEnd, ec);
+            if (ec) 
+			{
+                error = "cannot trim damaged tail: " + ec.message();
+                close();
+                return false;
+            }
+        }
+        if (validEnd == 0) 
+		{
+            OrderLogHeader header = OrderLog::makeHeader();
+            if (!file.write((const char*)&header, sizeof(header))) 
+			{
+                error = "cannot write header";
+                close();
+                return false;
+            }
+            validEnd = sizeof(header);
+            createdAt = header.createdAt;
+            nextStringId = 0;
+            fresh = true;
+        }
+        end = validEnd;
+
+        // Every segment but the last is sealed; the manifest must list exactly those
+        current = {};
+        current.begin = sizeof(OrderLogHeader);
+        if (!segments.empty()) 
+		{
+            current = segments.back();
+            segments.pop_back();
+            OrderManifest::fillFilters(path, current);
+        }
+        vector<OrderSegment> listed;
+        if (!OrderManifest::load(manifestPath, createdAt, listed) || !OrderManifest::sameSegments(listed, segments)) 
+		{
+            bool filled = true;
+            for (OrderSegment& segment : segments) 
+			{
+                filled = filled && OrderManifest::fillFilters(path, segment);
+            }
+            if (!filled || !OrderManifest::rewrite(manifestPath, createdAt, segments)) 
+			{
+                cerr << manifestPath << ": cannot be written, date queries will scan the history" << endl;
+                error_code ec;
+                filesystem::remove(manifestPath, ec);
+            }
+        }
+        if (!manifest.open(manifestPath)) 
+		{
+            cerr << manifestPath << ": cannot be opened, date queries will scan the history" << endl;
+        }
+
+        if (!customerIndex.open(indexPath, path, createdAt, frameCount, lastFrame, end)) 
+		{
+            cerr << indexPath << ": cannot be rebuilt, customer search will scan the history" << endl;
+        }
+        file.unlock();
+        return true;
+    }
+
+    // Takes the lock the kiosks append under and reads the frames other
+    // processes appended since this one last wrote, so encode() carries on
+    // from their last string and order id. Call unlock() once the frames are
+    // written. Returns false, and leaves the lock released, when the log
+    // cannot be followed any more.
+    bool lock(string& error) 
+	{
+        if (!file.lock()) 
+		{
+            error = "cannot be locked";
+            return false;
+        }
+        if (!catchUp(error)) 
+		{
+            file.unlock();
+            return false;
+        }
+        return true;
+    }
+
+    void unlock() { file.unlock(); }
+
+    // Appends the frames for the checkouts in book to out, defining any new
+    // strings first. Each checkout gets the next order id.
+    void encode(const OrderBook& book, string& out) 
+	{
+        for (const OrderHeader& header : book.orders) 
+		{
+            uint64_t orderId = nextOrderId++;
+            uint32_t perFrame = OrderLog::MAX_CHECKOUT_LINES;
+            for (uint32_t first = 0; first < header.lineCount; first += perFrame) 
+			{
+                encodeFrame(book, header, orderId, first, min(header.lineCount - first, perFrame), out);
+            }
+        }
+    }
+
+    // Appends frames produced by encode(); the customer index and manifest follow once they are written
+    bool write(const string& bytes) 
+	{
+        if (!file.write(bytes.data(), bytes.size())) 
+		{
+            customerIndex.discardStaged();
+            sealed.clear();
+            return false;
+        }
+        end += bytes.size();
+        customerIndex.commit(end);
+        if (!sealed.empty() && manifest.isOpen()) 
+		{
+            string entries;
+            for (OrderSegment& segment : sealed) 
+			{
+                segment.checksum = OrderLog::segmentChecksum(segment);
+                entries.append((const char*)&segment, sizeof(segment));
+            }
+            if (!manifest.write(entries.data(), entries.size())) 
+			{
+                cerr << manifestPath << ": write failed, date queries will scan the history" << endl;
+                manifest.close();
+                error_code ec;
+                filesystem::remove(manifestPath, ec);
+            }
+        }
+        sealed.clear();
+        return true;
+    }
+
+    bool sync() { return file.sync(); }
+    CustomerIndex& customers() { return customerIndex; }
+
+    void close() 
+	{
+        file.close();
+        manifest.close();
+        customerIndex.close();
+    }
+    bool isOpen() const { return file.isOpen(); }
+    // True when open() created the log, so older orders can be imported into it
+    bool isNew() const { return fresh; }
+
+private:
+    void encodeFrame(const OrderBook& book, const OrderHeader& header, uint64_t orderId, uint32_t first, uint32_t count, string& out) 
+	{
+        // Roll over to a new segment on a new day or when this one is full
+        int64_t day = OrderLog::localDay(header.orderTime);
+        uint64_t here = end + out.size();
+        if (current.orderCount > 0 && (day != current.day || here - current.begin >= OrderLog::MAX_SEGMENT_BYTES)) 
+		{
+            roll(day, here, out);
+        }
+        if (current.orderCount == 0) 
+		{
+            current.day = day;
+        }
+
+        OrderLogCheckout checkout = {};
+        checkout.orderId = orderId;
+        checkout.orderTime = (int64_t)header.orderTime;
+        checkout.totalCents = header.total.cents;
+        string_view customer = book.customerOf(header);
+        checkout.customerId = intern(customer, out);
+        checkout.dineId = intern(book.dineOptionOf(header), out);
+        checkout.lineCount = count;
+        string payload((const char*)&checkout, sizeof(checkout));
+        for (uint32_t i = first; i < first + count; ++i) 
+		{
+            const OrderLine& line = book.lines[header.firstLine + i];
+            OrderLogLine record = {};
+            record.priceCents = line.price.cents;
+            record.itemId = line.itemId;
+            record.itemNameId = intern(book.foodOf(line), out);
+            record.quantity = line.quantity;
+            payload.append((const char*)&record, sizeof(record));
+            current.items.add(book.foodOf(line));
+        }
+        customerIndex.stageOrder(customer, checkout.customerId, end + out.size());
+        OrderLog::appendFrame(out, OrderLog::FRAME_CHECKOUT, payload.data(), (uint16_t)payload.size());
+
+        current.customers.add(customer);
+        current.firstTime = current.orderCount == 0 ? checkout.orderTime : min(current.firstTime, checkout.orderTime);
+        current.lastTime = current.orderCount == 0 ? checkout.orderTime : max(current.lastTime, checkout.orderTime);
+        current.orderCount++;
+        current.end = end + out.size();
+    }
+
+    uint32_t intern(string_view value, string& out) 
+	{
+        auto it = ids.find(value);
+        if (it != ids.end()) 
+		{
+            return it->second;
+        }
+        uint32_t id = nextStringId++;
+        string_view name = idText.store(value);
+        ids.emplace(name, id);
+        names.push_back(name);
+
+        // Longer strings are cut to what a frame can hold
+        size_t length = min(value.size(), (size_t)0xFFFF - sizeof(id));
+        string payload((const char*)&id, sizeof(id));
+        payload.append(value, 0, length);
+        customerIndex.stageString(id, end + out.size());
+        OrderLog::appendFrame(out, OrderLog::FRAME_STRING, payload.data(), (uint16_t)payload.size());
+        return id;
+    }
+
+    // Takes in the frames between end and the end of the file, which another
+    // process appended since this one last wrote. Its customer index entries
+    // and manifest entries are already on disk, so only the state here changes.
+    bool catchUp(string& error) 
+	{
+        MappedFile log;
+        if (!log.open(logPath)) 
+		{
+            error = "cannot be mapped";
+            return false;
+        }
+        if (log.size() < end) 
+		{
+            error = "is shorter than this process wrote it";
+            return false;
+        }
+
+        uint64_t at = end;
+        uint16_t type, length;
+        const char* payload;
+        while (OrderLog::frameAt(log.view(), at, type, payload, length)) 
+		{
+            if (type == OrderLog::FRAME_STRING) 
+			{
+                uint32_t id;
+                if (length < sizeof(id)) 
+				{
+                    return failCatchUp("string frame is too short", error);
+                }
+                memcpy(&id, payload, sizeof(id));
+                if (id != nextStringId) 
+				{
+                    return failCatchUp("string id out of sequence", error);
+                }
+                string_view name = idText.store(string_view(payload + sizeof(id), length - sizeof(id)));
+                ids.emplace(name, id);
+                names.push_back(name);
+                ++nextStringId;
+                customerIndex.stageString(id, at);
+            }
+            else if (type == OrderLog::FRAME_SEGMENT && length == sizeof(OrderLogSegmentStart)) 
+			{
+                // The other process sealed the open segment and listed it in the manifest
+                OrderLogSegmentStart start;
+                memcpy(&start, payload, sizeof(start));
+                ids.clear();
+                names.clear();
+                idText.clear();
+                current = {};
+                current.begin = at;
+                current.day = start.day;
+                current.firstStringId = start.firstStringId;
+            }
+            else if (type == OrderLog::FRAME_CHECKOUT) 
+			{
+                const OrderLogCheckout* checkout = (const OrderLogCheckout*)payload;
+                string_view customer;
+                if (length < sizeof(OrderLogCheckout) || length != sizeof(OrderLogCheckout) + (size_t)checkout->lineCount * sizeof(OrderLogLine)) 
+				{
+                    return failCatchUp("checkout has the wrong size", error);
+                }
+                if (!nameOf(checkout->customerId, customer)) 
+				{
+                    return failCatchUp("checkout refers to an unknown string", error);
+                }
+                const OrderLogLine* lines = (const OrderLogLine*)(checkout + 1);
+                for (uint32_t i = 0; i < checkout->lineCount; ++i) 
+				{
+                    string_view item;
+                    if (!nameOf(lines[i].itemNameId, item)) 
+					{
+                        return failCatchUp("checkout refers to an unknown string", error);
+                    }
+                    current.items.add(item);
+                }
+                nextOrderId = max(nextOrderId, checkout->orderId + 1);
+                customerIndex.stageOrder(customer, checkout->customerId, at);
+
+                if (current.orderCount == 0) 
+				{
+                    current.day = OrderLog::localDay((time_t)checkout->orderTime);
+                }
+                current.customers.add(customer);
+                current.firstTime = current.orderCount == 0 ? checkout->orderTime : min(current.firstTime, checkout->orderTime);
+                current.lastTime = current.orderCount == 0 ? checkout->orderTime : max(current.lastTime, checkout->orderTime);
+                current.orderCount++;
+                current.end = at + OrderLog::frameSize(length);
+            }
+            else 
+			{
+                return failCatchUp("unknown frame type " + to_string(type), error);
+            }
+            at += OrderLog::frameSize(length);
+        }
+
+        // Whatever is left was cut short by a kiosk that crashed mid-append
+        if (at < log.size()) 
+		{
+            log.close();
+            error_code ec;
+            filesystem::resize_file(logPath, at, ec);
+            if (ec) 
+			{
+                return failCatchUp("cannot trim damaged tail: " + ec.message(), error);
+            }
+        }
+        if (at != end) 
+		{
+            customerIndex.follow(at);
+            end = at;
+        }
+        return true;
+    }
+
+    bool failCatchUp(const string& reason, string& error) 
+	{
+        customerIndex.discardStaged();
+        error = reason;
+        return false;
+    }
+
+    // A string defined in the open segment
+    bool nameOf(uint32_t id, string_view& name) const 
+	{
+        if (id < current.firstStringId || id - current.firstStringId >= names.size()) 
+		{
+            return false;
+        }
+        name = names[id - current.firstStringId];
+        return true;
+    }
+
+    // Seals the open segment at offset here and starts the next one with its own strings.
+    // Only the writer thread's own bookkeeping changes, so checkouts never wait on it.
+    void roll(int64_t day, uint64_t here, string& out) 
+	{
+        current.end = here;
+        sealed.push_back(current);
+        ids.clear();
+        names.clear();
+        idText.clear();
+
+        OrderLogSegmentStart start = {day, nextStringId, 0};
+        OrderLog::appendFrame(out, OrderLog::FRAME_SEGMENT, &start, sizeof(start));
+        current = {};
+        current.begin = here;
+        current.day = day;
+        current.firstStringId = nextStringId;
+    }
+};
+
+// Sort key for one order: when it was placed, then its row in the history
+struct OrderKey 
+{
+    int64_t time;
+    uint32_t row;
+
+    bool operator<(const OrderKey& other) const 
+	{
+        return time != other.time ? time < other.time : row < other.row;
+    }
+};
+
+class Algorithm 
+{
+public:
+    // Menus smaller than this are sorted with stable_sort; radix sort only pays off on large catalogs
+    static const size_t RADIX_THRESHOLD = 256;
+
+    // Packs the first 8 bytes of a name big-endian, so comparing keys compares name prefixes
+    static uint64_t nameKey(string_view name) 
+	{
+        uint64_t key = 0;
+        for (size_t i = 0; i < 8; ++i) 
+		{
+            key <<= 8;
+            if (i < name.size()) 
+			{
+                key |= (unsigned char)name[i];
+            }
+        }
+        return key;
+    }
+
+    // Maps a signed amount onto an unsigned integer with the same ordering
+    static uint64_t priceKey(Money price) 
+	{
+        return (uint64_t)price.cents ^ (1ULL << 63);
+    }
+
+    // Stable LSD radix sort of positions by keys[pos], one byte per pass.
+    // Passes where every key has the same digit are skipped.
+    static void radixSortByKey(vector<int>& perm, const vector<uint64_t>& keys) 
+	{
+        vector<int> scratch(perm.size());
+        for (int shift = 0; shift < 64; shift += 8) 
+		{
+            size_t count[257] = {0};
+            for (int pos : perm) 
+			{
+                count[((keys[pos] >> shift) & 0xFF) + 1]++;
+            }
+            if (count[((keys[perm[0]] >> shift) & 0xFF) + 1] == perm.size()) 
+			{
+                continue;
+            }
+
+            for (int d = 0; d < 256; ++d) 
+			{
+                count[d + 1] += count[d];
+            }
+            for (int pos : perm) 
+			{
+                scratch[count[(keys[pos] >> shift) & 0xFF]++] = pos;
+            }
+            perm.swap(scratch);
+        }
+    }
+
+    // Stable sort of positions by their normalized key
+    static void sortByKey(vector<int>& perm, const vector<uint64_t>& keys) 
+	{
+        if (perm.size() < RADIX_THRESHOLD) 
+		{
+            stable_sort(perm.begin(), perm.end(), [&](int a, int b) {
+                return keys[a] < keys[b];
+            });
+        } 
+		else 
+		{
+            radixSortByKey(perm, keys);
+        }
+    }
+
+    static vector<int> sortMenuByName(const vector<MenuItem>& menu) 
+	{
+        vector<uint64_t> keys(menu.size());
+        for (size_t i = 0; i < menu.size(); ++i) 
+		{
+            keys[i] = nameKey(menu[i].name);
+        }
+
+        vector<int> perm = identity(menu.size());
+        sortByKey(perm, keys);
+
+        // The key only covers the first 8 bytes, so finish runs of equal keys on the full name
+        for (size_t i = 0; i < perm.size(); ) 
+		{
+            size_t j = i + 1;
+            while (j < perm.size() && keys[perm[j]] == keys[perm[i]]) 
+			{
+                ++j;
+            }
+            if (j - i > 1) 
+			{
+                stable_sort(perm.begin() + i, perm.begin() + j, [&](int a, int b) {
+                    return menu[a].name < menu[b].name;
+                });
+            }
+            i = j;
+        }
+        return perm;
+    }
+
+    static vector<int> sortMenuByPrice(const vector<MenuItem>& menu, bool descending) 
+	{
+        vector<uint64_t> keys(menu.size());
+        for (size_t i = 0; i < menu.size(); ++i) 
+		{
+            keys[i] = descending ? ~priceKey(menu[i].price) : priceKey(menu[i].price);
+        }
+
+        vector<int> perm = identity(menu.size());
+        sortByKey(perm, keys);
+        return perm;
+    }
+
+    // Multi-key order: category name first, then ascending price within a category
+    static vector<int> sortMenuByCategoryThenPrice(const vector<MenuItem>& menu) 
+	{
+        vector<string_view> categories;
+        for (const auto& item : menu) 
+		{
+            categories.push_back(item.category);
+        }
+        sort(categories.begin(), categories.end());
+        categories.erase(unique(categories.begin(), categories.end()), categories.end());
+
+        vector<uint64_t> categoryKeys(menu.size());
+        for (size_t i = 0; i < menu.size(); ++i) 
+		{
+            categoryKeys[i] = lower_bound(categories.begin(), categories.end(), menu[i].category) - categories.begin();
+        }
+
+        // LSD order: sort by the minor key first, then stably by the major key
+        vector<int> perm = sortMenuByPrice(menu, false);
+        sortByKey(perm, categoryKeys);
+        return perm;
+    }
+
+    // Chronological order of the history, rows or checkouts, as a permutation
+    // of their positions; nothing is moved. Ties on time keep file order.
+    template <class Row>
+    static vector<uint32_t> sortOrdersByTime(const vector<Row>& orders) 
+	{
+        vector<OrderKey> keys(orders.size());
+        for (size_t i = 0; i < orders.size(); ++i) 
+		{
+            keys[i] = {timeOf(orders[i]), (uint32_t)i};
+        }
+        mergeSortKeys(keys);
+
+        vector<uint32_t> rows(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) 
+		{
+            rows[i] = keys[i].row;
+        }
+        return rows;
+    }
+
+    static int64_t timeOf(const Order& order) { return (int64_t)order.parsedOrderTime; }
+    static int64_t timeOf(const OrderHeader& header) { return (int64_t)header.orderTime; }
+
+    // Natural merge sort over (time, row) keys. The runs already present are found
+    // first, so history appended in time order costs one pass. Runs are then merged
+    // pairwise, ping-ponging between keys and one scratch buffer, with every pass
+    // cut into independent pieces for the shared thread pool.
+    static void mergeSortKeys(vector<OrderKey>& keys) 
+	{
+        size_t n = keys.size();
+        vector<size_t> runs = findRuns(keys);
+        if (runs.size() <= 2) 
+		{
+            return;
+        }
+
+        ThreadPool& pool = ThreadPool::shared();
+        size_t piece = max(size_t(MERGE_PIECE), n / (pool.size() * 4) + 1);
+        vector<OrderKey> scratch(n);
+        OrderKey* from = keys.data();
+        OrderKey* to = scratch.data();
+        vector<MergeTask> tasks;
+        vector<size_t> merged;
+
+        while (runs.size() > 2) 
+		{
+            tasks.clear();
+            merged.assign(1, 0);
+            for (size_t r = 0; r + 1 < runs.size(); r += 2) 
+			{
+                size_t begin = runs[r];
+                size_t mid = runs[r + 1];
+                size_t end = r + 2 < runs.size() ? runs[r + 2] : mid;  // an odd last run is copied
+                for (size_t out = begin; out < end; out += piece) 
+				{
+                    tasks.push_back({begin, mid, end, out, min(out + piece, end)});
+                }
+                merged.push_back(end);
+            }
+            pool.run(tasks.size(), [&](size_t t) 
+			{
+                mergePiece(from, to, tasks[t]);
+            });
+            swap(from, to);
+            runs.swap(merged);
+        }
+
+        if (from != keys.data()) 
+		{
+            keys.swap(scratch);
+        }
+    }
+
+    static vector<int> identity(size_t n) 
+	{
+        vector<int> perm(n);
+        for (size_t i = 0; i < n; ++i) 
+		{
+            perm[i] = (int)i;
+        }
+        return perm;
+    }
+
+private:
+    // Below this many output keys a merge is not split further
+    static const size_t MERGE_PIECE = 1 << 16;
+
+    // Output range [outBegin, outEnd) of merging [begin, mid) with [mid, end)
+    struct MergeTask 
+	{
+        size_t begin, mid, end, outBegin, outEnd;
+    };
+
+    // Runs shorter than this are extended with insertion sort, so shuffled input
+    // does not start out as millions of two-key runs
+    static const size_t MIN_RUN = 32;
+
+    // Boundaries of the ascending runs: 0, the start of each later run, keys.size().
+    // Strictly descending runs are reversed in place first; keys are all distinct.
+    static vector<size_t> findRuns(vector<OrderKey>& keys) 
+	{
+        vector<size_t> runs(1, 0);
+        size_t n = keys.size();
+        size_t start = 0;
+        while (start < n) 
+		{
+            size_t end = start + 1;
+            if (end < n && keys[end] < keys[start]) 
+			{
+                while (end < n && keys[end] < keys[end - 1]) ++end;
+                reverse(keys.begin() + start, keys.begin() + end);
+            }
+            else 
+			{
+                while (end < n && !(keys[end] < keys[end - 1])) ++end;
+            }
+            if (end - start < MIN_RUN && end < n) 
+			{
+                size_t limit = min(start + MIN_RUN, n);
+                for (; end < limit; ++end) 
+				{
+                    OrderKey key = keys[end];
+                    size_t at = end;
+                    for (; at > start && key < keys[at - 1]; --at) 
+					{
+                        keys[at] = keys[at - 1];
+                    }
+                    keys[at] = key;
+                }
+            }
+            runs.push_back(end);
+            start = end;
+        }
+        if (n == 0) 
+		{
+            runs.push_back(0);
+        }
+        return runs;
+    }
+
+    static void mergePiece(const OrderKey* from, OrderKey* to, const MergeTask& task) 
+	{
+        const OrderKey* a = from + task.begin;
+        const OrderKey* b = from + task.mid;
+        size_t na = task.mid - task.begin;
+        size_t nb = task.end - task.mid;
+
+        // How many of the first k merged keys come from a
+        size_t k = task.outBegin - task.begin;
+        size_t i = coRank(a, na, b, nb, k);
+        size_t j = k - i;
+        size_t iEnd = coRank(a, na, b, nb, task.outEnd - task.begin);
+        size_t jEnd = task.outEnd - task.begin - iEnd;
+
+        OrderKey* out = to + task.outBegin;
+        while (i < iEnd && j < jEnd) 
+		{
+            *out++ = b[j] < a[i] ? b[j++] : a[i++];
+        }
+        out = copy(a + i, a + iEnd, out);
+        copy(b + j, b + jEnd, out);
+    }
+
+    static size_t coRank(const OrderKey* a, size_t na, const OrderKey* b, size_t nb, size_t k) 
+	{
+        size_t low = k > nb ? k - nb : 0;
+        size_t high = min(k, na);
+        while (low < high) 
+		{
+            size_t i = low + (high - low) / 2;
+            if (a[i] < b[k - i - 1]) 
+			{
+                low = i + 1;
+            }
+            else 
+			{
+                high = i;
+            }
+        }
+        return low;
+    }
+};
+
+// Typo-tolerant lookup over item names and categories. Every text is split into words;
+// a trigram inverted index over the distinct words picks candidates sharing enough
+// trigrams with a query word, and a bit-parallel (Myers) edit distance confirms them.
+class TrigramIndex 
+{
+private:
+    vector<string> words;             // distinct lower-cased words
+    vector<vector<int>> wordItems;    // word id -> menu positions using that word
+    unordered_map<uint32_t, vector<int>> postings;  // packed trigram -> word ids
+    size_t itemCount = 0;
+
+    static vector<string> splitWords(const string& text) 
+	{
+        vector<string> result;
+        string word;
+        for (char c : text) 
+		{
+            if (isalnum((unsigned char)c)) 
+			{
+                word += (char)tolower((unsigned char)c);
+            } 
+			else if (!word.empty()) 
+			{
+                result.push_back(word);
+                word.clear();
+            }
+        }
+        if (!word.empty()) 
+		{
+            result.push_back(word);
+        }
+        return result;
+    }
+
+    // Distinct trigrams of the word padded with a space on both sides
+    static vector<uint32_t> trigrams(const string& word) 
+	{
+        string padded = " " + word + " ";
+        vector<uint32_t> grams;
+        for (size_t i = 0; i + 3 <= padded.size(); ++i) 
+		{
+            grams.push_back(((uint32_t)(unsigned char)padded[i] << 16) | ((uint32_t)(unsigned char)padded[i + 1] << 8) | (unsigned char)padded[i + 2]);
+        }
+        sort(grams.begin(), grams.end());
+        grams.erase(unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+
+    // Edits allowed for a query word of this length
+    static int maxDistance(size_t length) 
+	{
+        if (length <= 2) return 0;
+        if (length <= 5) return 1;
+        return 2;
+    }
+
+public:
+    void build(const vector<MenuItem>& menu) 
+	{
+        words.clear();
+        wordItems.clear();
+        postings.clear();
+        itemCount = menu.size();
+
+        unordered_map<string, int> wordIds;
+        for (int pos = 0; pos < (int)menu.size(); ++pos) 
+		{
+            for (const auto& word : splitWords(string(menu[pos].name) + " " + string(menu[pos].category))) 
+			{
+                auto found = wordIds.find(word);
+                int id;
+                if (found == wordIds.end()) 
+				{
+                    id = (int)words.size();
+                    wordIds[word] = id;
+                    words.push_back(word);
+                    wordItems.push_back({});
+                    for (uint32_t gram : trigrams(word)) 
+					{
+                        postings[gram].push_back(id);
+                    }
+                } 
+				else 
+				{
+                    id = found->second;
+                }
+                if (wordItems[id].empty() || wordItems[id].back() != pos) 
+				{
+                    wordItems[id].push_back(pos);
+                }
+            }
+        }
+    }
+
+    // Myers/Hyyrö bit-parallel Levenshtein distance of pattern (at most 64 chars) against text.
+    // Gives up and returns limit + 1 as soon as the distance is known to exceed limit.
+    static int boundedDistance(const string& pattern, const string& text, int limit) 
+	{
+        size_t m = pattern.size();
+        if (m == 0) 
+		{
+            return (int)text.size();
+        }
+
+        uint64_t peq[256] = {0};
+        for (size_t i = 0; i < m; ++i) 
+		{
+            peq[(unsigned char)pattern[i]] |= 1ULL << i;
+        }
+
+        uint64_t pv = (m == 64) ? ~0ULL : ((1ULL << m) - 1);
+        uint64_t mv = 0;
+        uint64_t high = 1ULL << (m - 1);
+        int score = (int)m;
+
+        for (size_t j = 0; j < text.size(); ++j) 
+		{
+            uint64_t eq = peq[(unsigned char)text[j]];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+
+            if (ph & high) score++;
+            else if (mh & high) score--;
+
+            // Each remaining text character can lower the score by at most one
+            if (score - (int)(text.size() - j - 1) > limit) 
+			{
+                return limit + 1;
+            }
+
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+        }
+        return score;
+    }
+
+    // Menu positions ranked by similarity to query (best first), at most limit of them
+    vector<int> search(const string& query, size_t limit) const 
+	{
+        vector<string> queryWords = splitWords(query);
+        vector<double> scores(itemCount, 0.0);
+        vector<int> touched;
+
+        for (auto queryWord : queryWords) 
+		{
+            if (queryWord.size() > 64) 
+			{
+                queryWord.resize(64);
+            }
+            int limitEdits = maxDistance(queryWord.size());
+            vector<uint32_t> grams = trigrams(queryWord);
+
+            // q-gram lemma: one edit destroys at most 3 trigrams
+            int needed = max(1, (int)grams.size() - 3 * limitEdits);
+
+            vector<uint8_t> shared(words.size(), 0);  // a word of at most 64 chars has at most 66 trigrams
+            vector<int> candidates;
+            for (uint32_t gram : grams) 
+			{
+                auto it = postings.find(gram);
+                if (it == postings.end()) 
+				{
+                    continue;
+                }
+                for (int id : it->second) 
+				{
+                    if (++shared[id] == needed) 
+					{
+                        candidates.push_back(id);
+                    }
+                }
+            }
+
+            // Best similarity this query word reaches for each item
+            unordered_map<int, double> best;
+            for (int id : candidates) 
+			{
+                const string& word = words[id];
+                if (abs((int)word.size() - (int)queryWord.size()) > limitEdits) 
+				{
+                    continue;
+                }
+                int distance = boundedDistance(queryWord, word, limitEdits);
+                if (distance > limitEdits) 
+				{
+                    continue;
+                }
+
+                double similarity = 1.0 - (double)distance / max(word.size(), queryWord.size());
+                for (int pos : wordItems[id]) 
+				{
+                    double& slot = best[pos];
+                    slot = max(slot, similarity);
+                }
+            }
+
+            for (const auto& entry : best) 
+			{
+                if (scores[entry.first] == 0.0) 
+				{
+                    touched.push_back(entry.first);
+                }
+                scores[entry.first] += entry.second;
+            }
+        }
+
+        sort(touched.begin(), touched.end(), [&](int a, int b) {
+            return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+        });
+        if (touched.size() > limit) 
+		{
+            touched.resize(limit);
+        }
+        return touched;
+    }
+};
+
+// Owns the one copy of every menu item. A food code is at most 4 characters, so it packs
+// into a uint32_t, and a flat open-addressing table (linear probing, at most half full)
+// maps the packed code to the item's slot: a lookup is one hash and usually one cache line.
+class MenuCatalog 
+{
+private:
+    struct Bucket 
+	{
+        uint32_t key;   // packed code, 0 = empty
+        int32_t slot;   // position in entries
+    };
+
+    MappedFile imageFile;  // menu.bin, when the items were loaded from it
+    StringArena text;      // strings of items parsed from menu.txt, added or edited
+    vector<MenuItem> entries;
+    vector<Bucket> table;
+    uint32_t mask = 0;
+
+    static uint32_t hash(uint32_t key) 
+	{
+        key *= 0x9E3779B1u;
+        return key ^ (key >> 16);
+    }
+
+    void insertBucket(uint32_t key, int32_t slot) 
+	{
+        uint32_t i = hash(key) & mask;
+        while (table[i].key != 0) 
+		{
+            i = (i + 1) & mask;
+        }
+        table[i] = {key, slot};
+    }
+
+    int32_t findSlot(uint32_t key) const 
+	{
+        if (table.empty() || key == 0) 
+		{
+            return -1;
+        }
+        uint32_t i = hash(key) & mask;
+        while (table[i].key != 0) 
+		{
+            if (table[i].key == key) 
+			{
+                return table[i].slot;
+            }
+            i = (i + 1) & mask;
+        }
+        return -1;
+    }
+
+    void rehash() 
+	{
+        size_t capacity = 16;
+        while (capacity < entries.size() * 2) 
+		{
+            capacity <<= 1;
+        }
+        table.assign(capacity, Bucket{0, -1});
+        mask = (uint32_t)(capacity - 1);
+        for (size_t i = 0; i < entries.size(); ++i) 
+		{
+            uint32_t key = packCode(entries[i].code);
+            if (key != 0 && findSlot(key) < 0) 
+			{
+                insertBucket(key, (int32_t)i);
+            }
+        }
+    }
+
+public:
+    // 0 when the code is empty, longer than 4 characters or holds spaces, commas or non-ASCII
+    static uint32_t packCode(string_view code) 
+	{
+        if (code.empty() || code.size() > 4) 
+		{
+            return 0;
+        }
+        uint32_t key = 0;
+        for (char c : code) 
+		{
+            if (c <= ' ' || c == ',' || (unsigned char)c > 126) 
+			{
+                return 0;
+            }
+            key = (key << 8) | (unsigned char)c;
+        }
+        return key;
+    }
+
+    static string unpackCode(uint32_t key) 
+	{
+        string code;
+        for (int shift = 24; shift >= 0; shift -= 8) 
+		{
+            char c = (char)((key >> shift) & 0xFF);
+            if (c != 0) 
+			{
+                code += c;
+            }
+        }
+        return code;
+    }
+
+    // Storage the item strings point into. readMenuFiles loads into one of them
+    // before assign(); the admin screens copy changed strings into strings().
+    MappedFile& image() { return imageFile; }
+    StringArena& strings() { return text; }
+
+    void assign(vector<MenuItem> items) 
+	{
+        entries = move(items);
+        rehash();
+    }
+
+    void clear() 
+	{
+        entries.clear();
+        rehash();
+        imageFile.close();
+        text.clear();
+    }
+
+    const vector<MenuItem>& items() const { return entries; }
+    size_t size() const { return entries.size(); }
+
+    const MenuItem* find(uint32_t key) const 
+	{
+        int32_t slot = findSlot(key);
+        return slot >= 0 ? &entries[slot] : nullptr;
+    }
+
+    const MenuItem* find(const string& code) const { return find(packCode(code)); }
+
+    MenuItem* find(const string& code) 
+	{
+        int32_t slot = findSlot(packCode(code));
+        return slot >= 0 ? &entries[slot] : nullptr;
+    }
+
+    // False when the code cannot be packed or is already taken
+    bool add(const MenuItem& item) 
+	{
+        uint32_t key = packCode(item.code);
+        if (key == 0 || findSlot(key) >= 0) 
+		{
+            return false;
+        }
+        MenuItem stored = item;
+        stored.code = text.store(item.code);
+        stored.name = text.store(item.name);
+        stored.category = text.store(item.category);
+        entries.push_back(stored);
+        if (entries.size() * 2 > table.size()) 
+		{
+            rehash();
+        } 
+		else 
+		{
+            insertBucket(key, (int32_t)entries.size() - 1);
+        }
+        return true;
+    }
+
+    bool remove(const string& code) 
+	{
+        int32_t slot = findSlot(packCode(code));
+        if (slot < 0) 
+		{
+            return false;
+        }
+        // Keep menu order; later slots shift down, so the table is rebuilt
+        entries.erase(entries.begin() + slot);
+        rehash();
+        return true;
+    }
+};
+
+enum class MenuOrder 
+{
+    Original,
+    ByName,
+    ByPrice,          // ascending, binary searched by price range search
+    ByPriceDesc,      // most expensive first, used by "Sort menu by price"
+    ByCategoryPrice   // grouped by category, cheapest first within each; searched by category search
+};
+
+// Column-oriented copy of the menu used by the combined category and price filter: a
+// contiguous price column and a column of interned category IDs. The filter scans the columns
+// 64 items at a time with AVX2 or SSE2 (scalar otherwise) and return a selection bitmap
+// where bit i is set when item i passes.
+class MenuColumns 
+{
+private:
+    vector<int32_t> prices;                      // sen, saturated to the int32 range
+    vector<uint32_t> categoryIds;
+    unordered_map<string_view, uint32_t> categoryLookup;  // category name -> id
+
+    static int32_t saturate(Money amount) 
+	{
+        return (int32_t)max<int64_t>(INT32_MIN, min<int64_t>(INT32_MAX, amount.cents));
+    }
+
+    // Bit i is set when item base + i passes; handles exactly 64 items
+    static uint64_t selectBlock(const int32_t* price, const uint32_t* category, int32_t minPrice, int32_t maxPrice, uint32_t categoryId, bool anyCategory) 
+	{
+        uint64_t bits = 0;
+#if defined(__AVX2__)
+        __m256i low = _mm256_set1_epi32(minPrice);
+        __m256i high = _mm256_set1_epi32(maxPrice);
+        __m256i wanted = _mm256_set1_epi32((int)categoryId);
+        for (int i = 0; i < 64; i += 8) 
+		{
+            __m256i p = _mm256_loadu_si256((const __m256i*)(price + i));
+            __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(low, p), _mm256_cmpgt_epi32(p, high));
+            uint32_t mask = ~(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+            if (!anyCategory) 
+			{
+                __m256i c = _mm256_loadu_si256((const __m256i*)(category + i));
+                mask &= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(c, wanted)));
+            }
+            bits |= (uint64_t)mask << i;
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128i low = _mm_set1_epi32(minPrice);
+        __m128i high = _mm_set1_epi32(maxPrice);
+        __m128i wanted = _mm_set1_epi32((int)categoryId);
+        for (int i = 0; i < 64; i += 4) 
+		{
+            __m128i p = _mm_loadu_si128((const __m128i*)(price + i));
+            __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(low, p), _mm_cmpgt_epi32(p, high));
+            uint32_t mask = ~(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+            if (!anyCategory) 
+			{
+                __m128i c = _mm_loadu_si128((const __m128i*)(category + i));
+                mask &= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(c, wanted)));
+            }
+            bits |= (uint64_t)mask << i;
+        }
+#else
+        for (int i = 0; i < 64; ++i) 
+		{
+            if (matches(price[i], category[i], minPrice, maxPrice, categoryId, anyCategory)) 
+			{
+                bits |= 1ULL << i;
+            }
+        }
+#endif
+        return bits;
+    }
+
+    static bool matches(int32_t price, uint32_t category, int32_t minPrice, int32_t maxPrice, uint32_t categoryId, bool anyCategory) 
+	{
+        return price >= minPrice && price <= maxPrice && (anyCategory || category == categoryId);
+    }
+
+public:
+    static const uint32_t NO_CATEGORY = 0xFFFFFFFFu;
+
+    void build(const vector<MenuItem>& menu) 
+	{
+        prices.clear();
+        categoryIds.clear();
+        categoryLookup.clear();
+
+        prices.reserve(menu.size());
+        categoryIds.reserve(menu.size());
+        for (const auto& item : menu) 
+		{
+            prices.push_back(saturate(item.price));
+
+            auto found = categoryLookup.emplace(item.category, (uint32_t)categoryLookup.size()).first;
+            categoryIds.push_back(found->second);
+        }
+    }
+
+    size_t size() const { return prices.size(); }
+
+    // NO_CATEGORY when no item uses this category
+    uint32_t categoryId(const string& category) const 
+	{
+        auto found = categoryLookup.find(category);
+        return found != categoryLookup.end() ? found->second : NO_CATEGORY;
+    }
+
+    // Items priced within [minPrice, maxPrice] and, unless anyCategory, in category categoryId
+    vector<uint64_t> select(Money minAmount, Money maxAmount, uint32_t categoryId, bool anyCategory) const 
+	{
+        int32_t minPrice = saturate(minAmount);
+        int32_t maxPrice = saturate(maxAmount);
+        size_t n = prices.size();
+        vector<uint64_t> bits((n + 63) / 64, 0);
+        if (!anyCategory && categoryId == NO_CATEGORY) 
+		{
+            return bits;
+        }
+
+        size_t fullBlocks = n / 64;
+        for (size_t block = 0; block < fullBlocks; ++block) 
+		{
+            bits[block] = selectBlock(&prices[block * 64], &categoryIds[block * 64], minPrice, maxPrice, categoryId, anyCategory);
+        }
+        for (size_t i = fullBlocks * 64; i < n; ++i) 
+		{
+            if (matches(prices[i], categoryIds[i], minPrice, maxPrice, categoryId, anyCategory)) 
+			{
+                bits[i / 64] |= 1ULL << (i % 64);
+            }
+        }
+        return bits;
+    }
+
+    // Positions of the set bits, in menu order
+    static vector<int> positions(const vector<uint64_t>& bits) 
+	{
+        vector<int> result;
+        for (size_t word = 0; word < bits.size(); ++word) 
+		{
+            uint64_t w = bits[word];
+            while (w != 0) 
+			{
+                result.push_back((int)(word * 64 + lowestBit(w)));
+                w &= w - 1;
+            }
+        }
+        return result;
+    }
+
+    static int lowestBit(uint64_t w) 
+	{
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, w);
+        return (int)index;
+#else
+        return __builtin_ctzll(w);
+#endif
+    }
+};
+
+// Precomputed orderings over one immutable menu vector, built once in loadMenu.
+// Each view stores positions into the menu, so switching views or searching never copies items.
+struct MenuIndex 
+{
+    vector<int> original;
+    vector<int> byName;
+    vector<int> byPrice;
+    vector<int> byPriceDesc;
+    vector<int> byCategory;
+    TrigramIndex fuzzy;       // typo-tolerant name/category search
+    MenuColumns columns;      // columnar copy scanned by the combined category and price filter
+
+    void build(const vector<MenuItem>& menu) 
+	{
+        original = Algorithm::identity(menu.size());
+        byName = Algorithm::sortMenuByName(menu);
+        byPrice = Algorithm::sortMenuByPrice(menu, false);
+        byPriceDesc = Algorithm::sortMenuByPrice(menu, true);
+        byCategory = Algorithm::sortMenuByCategoryThenPrice(menu);
+        fuzzy.build(menu);
+        columns.build(menu);
+    }
+
+    const vector<int>& view(MenuOrder order) const 
+	{
+        switch (order) 
+		{
+            case MenuOrder::ByName:          return byName;
+            case MenuOrder::ByPrice:         return byPrice;
+            case MenuOrder::ByPriceDesc:     return byPriceDesc;
+            case MenuOrder::ByCategoryPrice: return byCategory;
+            default:                         return original;
+        }
+    }
+};
+
+// Autocomplete index over item names: a sorted list of (lower-cased key, packed food code).
+// Every word start of a name is a key, so "piz" finds "New York Style Pizza".
+// A prefix query is one binary search plus a walk over the matching run.
+class NamePrefixIndex 
+{
+private:
+    struct Entry 
+	{
+        string key;
+        uint32_t code;
+
+        bool operator<(const Entry& other) const {
+            return key != other.key ? key < other.key : code < other.code;
+        }
+    };
+
+    vector<Entry> entries;
+
+    static vector<Entry> keysFor(const MenuItem& item) 
+	{
+        vector<Entry> keys;
+        string name = normalize(item.name);
+        for (size_t i = 0; i < name.size(); ++i) 
+		{
+            if (name[i] != ' ' && (i == 0 || name[i - 1] == ' ')) 
+			{
+                keys.push_back({name.substr(i), MenuCatalog::packCode(item.code)});
+            }
+        }
+        return keys;
+    }
+
+public:
+    static string normalize(string_view text) 
+	{
+        string result(text);
+        for (auto& c : result) 
+		{
+            c = (char)tolower((unsigned char)c);
+        }
+        return result;
+    }
+
+    void build(const vector<MenuItem>& menu) 
+	{
+        entries.clear();
+        for (const auto& item : menu) 
+		{
+            for (auto& entry : keysFor(item)) 
+			{
+                entries.push_back(move(entry));
+            }
+        }
+        sort(entries.begin(), entries.end());
+    }
+
+    void add(const MenuItem& item) 
+	{
+        for (auto& entry : keysFor(item)) 
+		{
+            entries.insert(upper_bound(entries.begin(), entries.end(), entry), move(entry));
+        }
+    }
+
+    // item must still carry the name it was indexed under
+    void remove(const MenuItem& item) 
+	{
+        for (const auto& entry : keysFor(item)) 
+		{
+            auto it = lower_bound(entries.begin(), entries.end(), entry);
+            if (it != entries.end() && it->key == entry.key && it->code == entry.code) 
+			{
+                entries.erase(it);
+            }
+        }
+    }
+
+    // Codes of up to limit items with a word starting with prefix (case-insensitive), ordered by the matching word
+    vector<uint32_t> lookup(const string& prefix, size_t limit) const 
+	{
+        vector<uint32_t> codes;
+        string key = normalize(prefix);
+        if (key.empty()) 
+		{
+            return codes;
+        }
+
+        auto it = lower_bound(entries.begin(), entries.end(), key, [](const Entry& entry, const string& k) {
+            return entry.key < k;
+        });
+        for (; it != entries.end() && codes.size() < limit; ++it) 
+		{
+            if (it->key.compare(0, key.size(), key) != 0) 
+			{
+                break;
+            }
+            // A name can match on more than one word; report each item once
+            if (find(codes.begin(), codes.end(), it->code) == codes.end()) 
+			{
+                codes.push_back(it->code);
+            }
+        }
+        return codes;
+    }
+};
+
+class SearchItem 
+{
+public:
+    // A binary search into the ascending price view, then a walk to maxPrice: cheapest first
+    static vector<MenuItem> searchByPriceRange(const vector<MenuItem>& menu, const MenuIndex& index, Money minPrice, Money maxPrice) {
+        vector<MenuItem> result;
+        auto it = lower_bound(index.byPrice.begin(), index.byPrice.end(), minPrice, [&menu](int pos, Money price) {
+            return menu[pos].price < price;
+        });
+        for (; it != index.byPrice.end() && menu[*it].price <= maxPrice; ++it) {
+            result.push_back(menu[*it]);
+        }
+        return result;
+    }
+
+    // The category view keeps each category in one run, cheapest first
+	static vector<MenuItem> searchByCategory(const vector<MenuItem>& menu, const MenuIndex& index, const string& category) {
+        auto first = lower_bound(index.byCategory.begin(), index.byCategory.end(), category, [&menu](int pos, const string& c) {
+            return menu[pos].category < c;
+        });
+        auto last = upper_bound(first, index.byCategory.end(), category, [&menu](const string& c, int pos) {
+            return c < menu[pos].category;
+        });
+        vector<MenuItem> result;
+        for (auto it = first; it != last; ++it) {
+            result.push_back(menu[*it]);
+        }
+        return result;
+    }
+
+    // Both filters in a single pass over the columns
+	static vector<MenuItem> searchByCategoryAndPrice(const vector<MenuItem>& menu, const MenuIndex& index, const string& category, Money minPrice, Money maxPrice) {
+        vector<uint64_t> bits = index.columns.select(minPrice, maxPrice, index.columns.categoryId(category), false);
+        return collect(menu, bits);
+    }
+    
+    // Overloaded search function for searching by name: autocomplete on any word of the name
+    static vector<MenuItem> searchByName(const MenuCatalog& catalog, const NamePrefixIndex& names, const string& prefix, size_t limit) {
+        vector<MenuItem> result;
+        for (uint32_t code : names.lookup(prefix, limit)) {
+            if (const MenuItem* item = catalog.find(code)) {
+                result.push_back(*item);
+            }
+        }
+        return result;
+    }
+
+    // Typo-tolerant search over names and categories, best matches first
+    static vector<MenuItem> searchFuzzy(const vector<MenuItem>& menu, const MenuIndex& index, const string& query, size_t limit) {
+        vector<MenuItem> result;
+        for (int pos : index.fuzzy.search(query, limit)) {
+            result.push_back(menu[pos]);
+        }
+        return result;
+    }
+
+    // Overloaded search function for searching by code
+    static vector<MenuItem> searchByCode(const MenuCatalog& catalog, const string& code) {
+        vector<MenuItem> result;
+        if (const MenuItem* item = catalog.find(code)) {
+            result.push_back(*item);
+        }
+        return result;
+    }
+
+private:
+    static vector<MenuItem> collect(const vector<MenuItem>& menu, const vector<uint64_t>& bits) {
+        vector<MenuItem> result;
+        for (int pos : MenuColumns::positions(bits)) {
+            result.push_back(menu[pos]);
+        }
+        return result;
+    }
+
+};
+
+
+// Base class
+class User 
+{
+protected:
+    string username;
+    string password;
+public:
+    User(const string& u, const string& p) : username(u), password(p) {}
+
+    // Virtual login function
+    virtual bool login(const string& u, const string& p)
+	 {
+        return username == u && password == p;
+    }
+
+    friend void displayUserDetails(const User& user);
+};
+
+void displayUserDetails(const User& user) 
+{
+    cout << "Username: " << user.username << endl;
+}
+
+// Derived class for Customer
+class Customer : public User 
+{
+public:
+    Customer(const string& u, const string& p) : User(u, p) {}
+
+    // Overridden login function
+    bool login(const string& u, const string& p) override 
+	{
+        if (User::login(u, p)) 
+		{
+            cout << "Customer login successful" << endl;
+            return true;
+        }
+        cout << "Customer login failed" << endl;
+        return false;
+    }
+};
+
+// Derived class for Admin
+class Admin : public User 
+{
+public:
+    Admin(const string& u, const string& p) : User(u, p) {}
+
+    bool login(const string& u, const string& p) override {
+        if (User::login(u, p)) {
+            cout << "Successfully logged in!" << endl;
+            return true;
+        } else {
+            cout << "Invalid username and password! Please enter again." << endl;
+            return false;
+        }
+    }
+
+    
+    // nullptr when no item has this code
+    const MenuItem* getMenuItemDetails(const string& code, const MenuCatalog& catalog) 
+	{
+        return catalog.find(code);
+	}
+    
+
+    bool addMenuItem(MenuCatalog& catalog, NamePrefixIndex& names, const MenuItem& item) 
+	{
+        if (!catalog.add(item)) 
+		{
+            return false;
+        }
+        names.add(item);
+        return true;
+    }
+
+    bool removeMenuItem(MenuCatalog& catalog, NamePrefixIndex& names, const string& code) 
+	{
+        const MenuItem* item = catalog.find(code);
+        if (!item) 
+		{
+            return false;
+        }
+        names.remove(*item);
+        return catalog.remove(code);
+    }
+
+    void editMenuItem(MenuCatalog& catalog, NamePrefixIndex& names, const string& code) 
+	{
+        MenuItem* found = catalog.find(code);
+        if (!found) 
+		{
+            return;
+        }
+
+        MenuItem& item = *found;
+        names.remove(item);
+
+        cout << "Editing item with code: " << code << endl;
+        cout << "Enter new name (or press enter to keep current): ";
+        string newName;
+        cin.ignore();
+        getline(cin, newName);
+        if (!newName.empty()) 
+		{
+            item.name = catalog.strings().store(newName);
+        }
+
+        cout << "Enter new category (or press enter to keep current): ";
+        string newCategory;
+        getline(cin, newCategory);
+        if (!newCategory.empty()) 
+		{
+            item.category = catalog.strings().store(newCategory);
+        }
+
+        cout << "Enter new price (or press enter to keep current): ";
+        string priceStr;
+        getline(cin, priceStr);
+        if (!priceStr.empty() && !Money::parse(priceStr, item.price)) 
+		{
+            cout << "Invalid price, keeping RM " << item.price << endl;
+        }
+        names.add(item);
+
+        cout << "Item updated successfully." << endl;
+    }
+
+    void saveMenuToFile(const vector<MenuItem>& menu) 
+	{
+        ofstream menuFile("menu.txt");
+        if (!menuFile) 
+		{
+            cerr << "Failed to open menu.txt" << endl;
+            return;
+        }
+
+        for (const auto& item : menu) 
+		{
+            menuFile << item.code << "," << item.name << "," << item.category << "," << item.price << endl;
+        }
+
+        menuFile.close();
+        cout << "Menu saved to menu.txt" << endl;
+
+        if (!MenuImage::write("menu.bin", "menu.txt", menu)) 
+		{
+            cerr << "Failed to write menu.bin" << endl;
+        }
+    }
+    
+    friend void displayAdminDetails(const Admin& admin);
+
+};
+
+
+void displayAdminDetails(const Admin& admin) 
+{
+    cout << "Admin Username: " << admin.username << endl;
+}
+
+struct MenuLoadError 
+{
+    size_t line;
+    string message;
+};
+
+// Single-pass parser for menu.txt ("code,name,category,price" per line).
+// Fields are sliced out of the mapped file as string_views and copied once into strings.
+class MenuLoader 
+{
+public:
+    static bool load(const string& path, StringArena& strings, vector<MenuItem>& items, vector<MenuLoadError>& errors) 
+	{
+        MappedFile file;
+        if (!file.open(path)) 
+		{
+            errors.push_back({0, "cannot open " + path});
+            return false;
+        }
+
+        string_view text = file.view();
+        items.reserve(items.size() + count(text.begin(), text.end(), '\n') + 1);
+
+        unordered_map<string_view, size_t> seenCodes;  // code -> line number, views into the mapping
+        size_t lineNo = 0;
+        while (!text.empty()) 
+		{
+            size_t end = text.find('\n');
+            string_view line = text.substr(0, end);
+            text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+            ++lineNo;
+
+            if (!line.empty() && line.back() == '\r') 
+			{
+                line.remove_suffix(1);
+            }
+            if (line.empty()) 
+			{
+                continue;
+            }
+
+            string_view fields[4];
+            string error;
+            if (!splitLine(line, fields, error)) 
+			{
+                errors.push_back({lineNo, error});
+                continue;
+            }
+
+            Money price;
+            if (!parsePrice(fields[3], price)) 
+			{
+                errors.push_back({lineNo, "invalid price '" + string(fields[3]) + "'"});
+                continue;
+            }
+
+            if (MenuCatalog::packCode(fields[0]) == 0) 
+			{
+                errors.push_back({lineNo, "invalid food code '" + string(fields[0]) + "' (1-4 characters, no spaces or commas)"});
+                continue;
+            }
+
+            auto seen = seenCodes.find(fields[0]);
+            if (seen != seenCodes.end()) 
+			{
+                errors.push_back({lineNo, "duplicate food code " + string(fields[0]) + " (first defined on line " + to_string(seen->second) + ")"});
+                continue;
+            }
+            seenCodes[fields[0]] = lineNo;
+
+            MenuItem item;
+            item.code = strings.store(fields[0]);
+            item.name = strings.store(fields[1]);
+            item.category = strings.store(fields[2]);
+            item.price = price;
+            items.push_back(item);
+        }
+
+        return true;
+    }
+
+    // Parses a price such as "7.8"; surrounding spaces are allowed, negative prices are rejected
+    static bool parsePrice(string_view text, Money& price) 
+	{
+        return Money::parse(text, price) && price.cents >= 0;
+    }
+
+private:
+    static bool splitLine(string_view line, string_view (&fields)[4], string& error) 
+	{
+        size_t start = 0;
+        for (int i = 0; i < 3; ++i) 
+		{
+            size_t comma = line.find(',', start);
+            if (comma == string_view::npos) 
+			{
+                error = "expected 4 comma-separated fields, found " + to_string(i + 1);
+                return false;
+            }
+            fields[i] = line.substr(start, comma - start);
+            start = comma + 1;
+        }
+        fields[3] = line.substr(start);
+
+        if (fields[0].empty()) 
+		{
+            error = "missing food code";
+            return false;
+        }
+        return true;
+    }
+};
+
+// Unbounded multi-producer single-consumer queue (Vyukov). A push is one atomic
+// exchange plus one store, so checkouts never block each other; only the writer
+// thread calls pop().
+template <typename T>
+class MpscQueue 
+{
+private:
+    struct Node 
+	{
+        atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    atomic<Node*> head;  // last node pushed
+    Node* tail;          // consumer side, always a node whose value was already taken
+
+public:
+    MpscQueue() 
+	{
+        Node* stub = new Node();
+        head.store(stub);
+        tail = stub;
+    }
+
+    ~MpscQueue() 
+	{
+        T discard;
+        while (pop(discard)) {}
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) 
+	{
+        Node* node = new Node();
+        node->value = move(value);
+        Node* prev = head.exchange(node);
+        prev->next.store(node, memory_order_release);
+    }
+
+    // False when the queue is empty or the newest push is still linking itself in
+    bool pop(T& value) 
+	{
+        Node* next = tail->next.load(memory_order_acquire);
+        if (!next) 
+		{
+            return false;
+        }
+        value = move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+    // True once any push has started, even if pop() cannot see it yet
+    bool pending() const 
+	{
+        return head.load() != tail;
+    }
+};
+
+// How long recordOrder waits before the checkout carries on
+enum class Durability 
+{
+    None,      // return once queued; the OS flushes the file when it likes
+    Batch,     // wait for the batch containing the order to be written and fsynced
+    PerOrder   // wait for an fsync of the order on its own
+};
+
+// Reads the order history into memory: from orders.log when there is one,
+// otherwise by parsing the human-readable orders.txt
+class OrderHistoryLoader 
+{
+public:
+    // Reads orders.log unless useLog is false (the log was disabled) or the log
+    // holds fewer rows than orders.txt: a kiosk whose log was disabled goes on
+    // writing orders.txt alone, so the text is the full history.
+    static bool load(const string& logPath, const string& textPath, bool useLog, OrderBook& orders) 
+	{
+        string error;
+        if (useLog && loadLog(logPath, orders, error) && error.empty()) 
+		{
+            if (orders.lines.size() >= textRows(textPath)) 
+			{
+                return true;
+            }
+            cerr << logPath << ": behind " << textPath << ", reading " << textPath << " instead" << endl;
+        }
+        else if (!error.empty()) 
+		{
+            cerr << logPath << ": " << error << ", reading " << textPath << " instead" << endl;
+        }
+        return loadText(textPath, orders);
+    }
+
+    // Non-blank lines of orders.txt, one per item ordered
+    static size_t textRows(const string& path) 
+	{
+        MappedFile file;
+        if (!file.open(path)) 
+		{
+            return 0;
+        }
+        string_view text = file.view();
+        size_t rows = 0;
+        for (size_t start = 0; start < text.size(); ) 
+		{
+            size_t newline = text.find('\n', start);
+            if (newline == string_view::npos) 
+			{
+                newline = text.size();
+            }
+            if (newline > start && !(newline == start + 1 && text[start] == '\r')) 
+			{
+                ++rows;
+            }
+            start = newline + 1;
+        }
+        return rows;
+    }
+
+    // Returns false when the log is missing or its header is bad. A damaged frame
+    // ends the history early; the orders before it are kept and error is set.
+    static bool loadLog(const string& path, OrderBook& orders, string& error) 
+	{
+        OrderLogReader reader;
+        if (!reader.open(path, error)) 
+		{
+            return false;
+        }
+        orders.clear();
+        OrderLogEntry entry;
+        while (reader.next(entry)) 
+		{
+            OrderLogReader::addTo(orders, entry);
+        }
+        error = reader.error();
+        return true;
+    }
+
+    // Loads the orders placed in [from, to). Only the log segments whose time range
+    // overlaps it are read, plus the open segment the manifest does not list yet.
+    // Without a usable log or manifest the whole history is loaded and filtered.
+    // segmentsRead reports how many segments were actually read.
+    static bool loadRange(const string& logPath, const string& manifestPath, const string& textPath, bool useLog,
+                          time_t from, time_t to, vector<Order>& orders, size_t& segmentsRead) 
+	{
+        return loadMatching(logPath, manifestPath, textPath, useLog,
+            [&](const OrderSegment& segment) { return segment.lastTime >= (int64_t)from && segment.firstTime < (int64_t)to; },
+            [&](const OrderLogEntry& entry) { return entry.checkout->orderTime >= (int64_t)from && entry.checkout->orderTime < (int64_t)to; },
+            [&](const OrderBook& book, vector<Order>& rows) 
+			{
+                book.select([&](const OrderHeader& header, const OrderLine&) { return header.orderTime >= from && header.orderTime < to; }, rows);
+            },
+            orders, segmentsRead);
+    }
+
+    // Same, for the orders of one customer; segments whose name filter rules the
+    // customer out are skipped, so a name that was never used reads almost nothing
+    static bool loadCustomer(const string& logPath, const string& manifestPath, const string& textPath, bool useLog,
+                             const string& customer, vector<Order>& orders, size_t& segmentsRead) 
+	{
+        return loadMatching(logPath, manifestPath, textPath, useLog,
+            [&](const OrderSegment& segment) { return segment.customers.mayContain(customer); },
+            [&](const OrderLogEntry& entry) { return entry.customerName == customer; },
+            [&](const OrderBook& book, vector<Order>& rows) 
+			{
+                uint32_t id;
+                if (book.names.find(customer, id)) 
+				{
+                    book.select([&](const OrderHeader& header, const OrderLine&) { return header.customerId == id; }, rows);
+                }
+            },
+            orders, segmentsRead);
+    }
+
+    // Same, for the orders of one food item
+    static bool loadItem(const string& logPath, const string& manifestPath, const string& textPath, bool useLog,
+                         const string& item, vector<Order>& orders, size_t& segmentsRead) 
+	{
+        return loadMatching(logPath, manifestPath, textPath, useLog,
+            [&](const OrderSegment& segment) { return segment.items.mayContain(item); },
+            [&](const OrderLogEntry& entry) { return entry.foodDetails == item; },
+            [&](const OrderBook& book, vector<Order>& rows) 
+			{
+                uint32_t id;
+                if (book.names.find(item, id)) 
+				{
+                    book.select([&](const OrderHeader&, const OrderLine& line) { return line.foodId == id; }, rows);
+                }
+            },
+            orders, segmentsRead);
+    }
+
+    // Parses orders.txt over a read-only mapping. The file is cut into chunks at
+    // line boundaries, the chunks are parsed on the shared thread pool and the
+    // results are joined in file order. Blank and malformed lines are skipped.
+    // Consecutive lines with the same customer, dine option and time make up one
+    // checkout; checkouts are numbered from 1 in file order.
+    static bool loadText(const string& path, OrderBook& orders) 
+	{
+        MappedFile file;
+        if (!file.open(path)) 
+        {
+            return false;
+        }
+        string_view text = file.view();
+
+        ThreadPool& pool = ThreadPool::shared();
+        size_t chunkCount = min(pool.size() * 4, text.size() / MIN_CHUNK_BYTES + 1);
+        vector<size_t> bounds = splitAtLines(text, chunkCount);
+
+        vector<OrderBook> parts(bounds.size() - 1);
+        pool.run(parts.size(), [&](size_t c) 
+		{
+            parseChunk(text.substr(bounds[c], bounds[c + 1] - bounds[c]), parts[c]);
+        });
+
+        size_t totalOrders = 0, totalLines = 0;
+        for (const auto& part : parts) 
+		{
+            totalOrders += part.orders.size();
+            totalLines += part.lines.size();
+        }
+        orders.clear();
+        orders.orders.reserve(totalOrders);
+        orders.lines.reserve(totalLines);
+        for (auto& part : parts) 
+		{
+            // Also rejoins a checkout cut in two by a chunk boundary
+            orders.append(part);
+            part.clear();
+        }
+        for (size_t i = 0; i < orders.orders.size(); ++i) 
+		{
+            orders.orders[i].orderId = i + 1;
+        }
+        return true;
+    }
+
+    // Parses one "name,dine,food,quantity,price,ctime" line
+    static bool parseLine(string_view line, Order& order) 
+	{
+        OrderTextRow row;
+        if (!parseFields(line, row)) 
+		{
+            return false;
+        }
+        order.customerName.assign(row.customerName.data(), row.customerName.size());
+        order.dineOption.assign(row.dineOption.data(), row.dineOption.size());
+        order.foodDetails.assign(row.foodDetails.data(), row.foodDetails.size());
+        order.orderTime.assign(row.orderTime.data(), row.orderTime.size());
+        order.quantity = row.quantity;
+        order.price = row.price;
+        order.parsedOrderTime = row.parsedOrderTime;
+        // Calculate total price for the order
+        order.totalPrice = order.quantity * order.price;
+        order.itemId = 0;
+        return true;
+    }
+
+    // The same without copying: the fields of row point into line
+    static bool parseFields(string_view line, OrderTextRow& row) 
+	{
+        if (!line.empty() && line.back() == '\r') 
+		{
+            line.remove_suffix(1);
+        }
+        string_view fields[6];
+        for (int i = 0; i < 5; ++i) 
+		{
+            size_t comma = line.find(',');
+            if (comma == string_view::npos) 
+			{
+                return false;
+            }
+            fields[i] = line.substr(0, comma);
+            line.remove_prefix(comma + 1);
+        }
+        fields[5] = line;
+
+        if (fields[0].empty() || !digits(fields[3], row.quantity) || !Money::parse(fields[4], row.price)) 
+		{
+            return false;
+        }
+        row.customerName = fields[0];
+        row.dineOption = fields[1];
+        row.foodDetails = fields[2];
+        row.orderTime = fields[5];
+        if (!parseCtime(fields[5], row.parsedOrderTime)) 
+		{
+            row.parsedOrderTime = 0;
+        }
+        return true;
+    }
+
+    // Parses the fixed-width ctime() layout "Sun Jun 16 21:04:29 2024" as local time
+    static bool parseCtime(string_view text, time_t& when) 
+	{
+        static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        if (text.size() < 24 || text[3] != ' ' || text[7] != ' ' || text[13] != ':' || text[16] != ':' || text[19] != ' ') 
+		{
+            return false;
+        }
+
+        int month = -1;
+        for (int m = 0; m < 12; ++m) 
+		{
+            if (text.compare(4, 3, months + 3 * m, 3) == 0) 
+			{
+                month = m;
+                break;
+            }
+        }
+        int day, hour, minute, second, year;
+        if (month < 0 ||
+            !digits(text.substr(8, 2), day) || !digits(text.substr(11, 2), hour) ||
+            !digits(text.substr(14, 2), minute) || !digits(text.substr(17, 2), second) ||
+            !digits(text.substr(20, 4), year) ||
+            day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) 
+		{
+            return false;
+        }
+
+        // mktime consults the time zone rules on every call, and all lines of a
+        // checkout share one timestamp, so each thread remembers the last hour it converted
+        static thread_local int64_t cachedHour = -1;
+        static thread_local time_t cachedStart = 0;
+        int64_t hourKey = (((int64_t)year * 12 + month) * 32 + day) * 24 + hour;
+        if (hourKey != cachedHour) 
+		{
+            tm fields = {};
+            fields.tm_year = year - 1900;
+            fields.tm_mon = month;
+            fields.tm_mday = day;
+            fields.tm_hour = hour;
+            fields.tm_isdst = -1;
+            time_t start = mktime(&fields);
+            if (start == (time_t)-1) 
+			{
+                return false;
+            }
+            cachedHour = hourKey;
+            cachedStart = start;
+        }
+        when = cachedStart + minute * 60 + second;
+        return true;
+    }
+
+private:
+    // Reads the sealed segments wanted() accepts and the open tail of the log,
+    // keeping the orders keep() accepts. Falls back to loading the whole history
+    // and letting select() pick the rows when the log or its manifest cannot be used.
+    static bool loadMatching(const string& logPath, const string& manifestPath, const string& textPath, bool useLog,
+                             const function<bool(const OrderSegment&)>& wanted,
+                             const function<bool(const OrderLogEntry&)>& keep,
+                             const function<void(const OrderBook&, vector<Order>&)>& select,
+                             vector<Order>& orders, size_t& segmentsRead) 
+	{
+        orders.clear();
+        segmentsRead = 0;
+        OrderLogReader probe;
+        string error;
+        vector<OrderSegment> segments;
+        if (useLog && probe.open(logPath, error) && OrderManifest::load(manifestPath, probe.header().createdAt, segments)) 
+		{
+            // The manifest only lists sealed segments; the rest of the log is read as one
+            uint64_t tail = segments.empty() ? sizeof(OrderLogHeader) : segments.back().end;
+            uint64_t logEnd = probe.fileSize();
+            bool damaged = false;
+            for (size_t i = 0; i <= segments.size() && !damaged; ++i) 
+			{
+                bool open = i == segments.size();
+                uint64_t begin = open ? tail : segments[i].begin;
+                uint64_t end = open ? logEnd : segments[i].end;
+                if (begin >= end || (!open && !wanted(segments[i]))) 
+				{
+                    continue;
+                }
+                OrderLogReader reader;
+                OrderLogEntry entry;
+                if (!reader.openSegment(logPath, begin, end, error)) 
+				{
+                    damaged = true;
+                    break;
+                }
+                while (reader.next(entry)) 
+				{
+                    if (keep(entry)) 
+					{
+                        orders.push_back(OrderLogReader::toOrder(entry));
+                    }
+                }
+                // The open segment may end in a torn append; anything else is damage
+                if (!reader.error().empty() && !(open && reader.isTruncated())) 
+				{
+                    error = reader.error();
+                    damaged = true;
+                }
+                ++segmentsRead;
+            }
+            if (!damaged) 
+			{
+                return true;
+            }
+            cerr << logPath << ": " << error << ", reading the whole history instead" << endl;
+        }
+
+        OrderBook all;
+        if (!load(logPath, textPath, useLog, all)) 
+		{
+            return false;
+        }
+        orders.clear();
+        segmentsRead = 0;
+        select(all, orders);
+        return true;
+    }
+
+    static const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+    // Chunk boundaries: 0, then offsets just past a newline, then text.size()
+    static vector<size_t> splitAtLines(string_view text, size_t chunkCount) 
+	{
+        vector<size_t> bounds(1, 0);
+        for (size_t c = 1; c < chunkCount; ++c) 
+		{
+            size_t target = max(bounds.back(), text.size() / chunkCount * c);
+            size_t newline = text.find('\n', target);
+            if (newline == string_view::npos) 
+			{
+                break;
+            }
+            bounds.push_back(newline + 1);
+        }
+        bounds.push_back(text.size());
+        return bounds;
+    }
+
+    static void parseChunk(string_view chunk, OrderBook& orders) 
+	{
+        orders.lines.reserve(chunk.size() / 64);
+        OrderTextRow row;
+        while (!chunk.empty()) 
+		{
+            size_t newline = chunk.find('\n');
+            string_view line = chunk.substr(0, newline);
+            chunk.remove_prefix(newline == string_view::npos ? chunk.size() : newline + 1);
+            if (parseFields(line, row)) 
+			{
+                orders.addRow(row);
+            }
+        }
+    }
+
+    // Day of month is space padded (" 7"), so leading spaces are allowed
+    static bool digits(string_view field, int& value) 
+	{
+        while (!field.empty() && field.front() == ' ') 
+		{
+            field.remove_prefix(1);
+        }
+        auto result = from_chars(field.data(), field.data() + field.size(), value);
+        return !field.empty() && result.ec == errc() && result.ptr == field.data() + field.size();
+    }
+};
+
+// A one-pass source of orders, so the history can be displayed or exported
+// without holding all of it in memory
+class OrderStream 
+{
+public:
+    virtual ~OrderStream() {}
+    virtual bool next(Order& order) = 0;
+};
+
+// The items of a loaded history as flat rows, checkout by checkout
+class OrderBookStream : public OrderStream 
+{
+private:
+    const OrderBook& book;
+    size_t header = 0;
+    uint32_t line = 0;
+
+public:
+    explicit OrderBookStream(const OrderBook& book) : book(book) {}
+
+    bool next(Order& order) override 
+	{
+        while (header < book.orders.size() && line >= book.orders[header].lineCount) 
+		{
+            ++header;
+            line = 0;
+        }
+        if (header >= book.orders.size()) 
+		{
+            return false;
+        }
+        book.row(book.orders[header], line++, order);
+        return true;
+    }
+};
+
+// Reads the history straight from disk in file order: orders.log when it is
+// usable, otherwise orders.txt line by line
+class HistoryOrderStream : public OrderStream 
+{
+private:
+    OrderLogReader reader;
+    MappedFile text;
+    string_view rest;
+    bool fromLog = false;
+    Order last;  // previous orders.txt row, to number the checkouts as loadText() does
+
+public:
+    bool open(const string& logPath, const string& textPath) 
+	{
+        string error;
+        fromLog = reader.open(logPath, error);
+        if (fromLog) 
+		{
+            return true;
+        }
+        if (!error.empty()) 
+		{
+            cerr << logPath << ": " << error << ", reading " << textPath << " instead" << endl;
+        }
+        if (!text.open(textPath)) 
+		{
+            return false;
+        }
+        rest = text.view();
+        return true;
+    }
+
+    bool next(Order& order) override 
+	{
+        if (fromLog) 
+		{
+            OrderLogEntry entry;
+            if (!reader.next(entry)) 
+			{
+                if (!reader.error().empty()) 
+				{
+                    cerr << "orders.log: " << reader.error() << ", history after it is skipped" << endl;
+                }
+                return false;
+            }
+            OrderLogReader::toOrder(entry, order);
+            return true;
+        }
+        while (!rest.empty()) 
+		{
+            size_t newline = rest.find('\n');
+            string_view line = rest.substr(0, newline);
+            rest.remove_prefix(newline == string_view::npos ? rest.size() : newline + 1);
+            if (OrderHistoryLoader::parseLine(line, order)) 
+			{
+                bool sameCheckout = last.orderId != 0 && order.parsedOrderTime == last.parsedOrderTime &&
+                                    order.customerName == last.customerName && order.dineOption == last.dineOption;
+                order.orderId = sameCheckout ? last.orderId : last.orderId + 1;
+                last.orderId = order.orderId;
+                last.parsedOrderTime = order.parsedOrderTime;
+                last.customerName = order.customerName;
+                last.dineOption = order.dineOption;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// orders.pages: header, the log offset and time of the first checkout of every
+// page, then the offset of every string frame so a page can name its rows
+// without reading the frames before it
+struct OrderPageIndexHeader 
+{
+    char magic[8];         // "PSPAGEIX"
+    uint32_t version;
+    uint32_t pageOrders;   // checkouts per page
+    int64_t logCreatedAt;  // identifies the log the entries point into
+    uint64_t coveredEnd;   // log bytes the entries account for
+    uint64_t orderCount;
+    uint64_t lastOrderId;
+    int64_t totalCents;    // revenue of the orders covered
+    uint32_t pageCount;
+    uint32_t stringCount;
+    uint32_t checksum;     // CRC-32C of the fields above and everything after the header
+    uint32_t reserved;
+};
+
+struct OrderPageEntry 
+{
+    uint64_t logOffset;    // first frame of the page's first checkout
+    int64_t orderTime;
+};
+
+static_assert(sizeof(OrderPageIndexHeader) == 72, "orders.pages header layout changed");
+static_assert(sizeof(OrderPageEntry) == 16, "orders.pages entry layout changed");
+
+// Sparse index of orders.log for paging through the history. Only every
+// PAGE_ORDERS-th checkout is recorded, so a page is read by seeking to its
+// entry and walking that page's frames. The index is kept up to date when it
+// is opened: only the part of the log written since the last open is walked.
+class OrderPageIndex 
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const uint32_t PAGE_ORDERS = 20;
+
+private:
+    string indexPath;
+    MappedFile log;
+    OrderPageIndexHeader state = {};
+    vector<OrderPageEntry> pages;
+    vector<uint64_t> stringOffsets;  // string id -> defining frame
+
+public:
+    // Returns false when there is no usable log; error is set when the log
+    // exists but cannot be read
+    bool open(const string& path, const string& logPath, string& error) 
+	{
+        indexPath = path;
+        OrderLogReader probe;
+        if (!probe.open(logPath, error)) 
+		{
+            return false;
+        }
+        int64_t createdAt = probe.header().createdAt;
+        probe.close();
+        if (!log.open(logPath)) 
+		{
+            error = "cannot be mapped";
+            return false;
+        }
+
+        if (!load(createdAt)) 
+		{
+            state = {};
+            memcpy(state.magic, "PSPAGEIX", 8);
+            state.version = VERSION;
+            state.pageOrders = PAGE_ORDERS;
+            state.logCreatedAt = createdAt;
+            state.coveredEnd = sizeof(OrderLogHeader);
+            pages.clear();
+            stringOffsets.clear();
+        }
+        if (extend() && !save()) 
+		{
+            cerr << indexPath << ": write failed, the history will be indexed again next time" << endl;
+        }
+        return true;
+    }
+
+    uint64_t orderCount() const { return state.orderCount; }
+    size_t pageCount() const { return pages.size(); }
+    Money revenue() const { return Money(state.totalCents); }
+
+    // The page holding the first order placed at or after when, or the last
+    // page when every order is older. Only the first time of each page is
+    // indexed, so the page before the one found is read to see where it ends.
+    size_t pageAt(time_t when) const 
+	{
+        size_t page = lower_bound(pages.begin(), pages.end(), (int64_t)when,
+                                  [](const OrderPageEntry& entry, int64_t time) { return entry.orderTime < time; }) - pages.begin();
+        if (page > 0) 
+		{
+            OrderBook previous;
+            string error;
+            if (page == pages.size() || (readPage(page - 1, previous, error) && !previous.orders.empty() && previous.orders.back().orderTime >= when)) 
+			{
+                return page - 1;
+            }
+        }
+        return page;
+    }
+
+    // Fills book with the checkouts of one page
+    bool readPage(size_t page, OrderBook& book, string& error) const 
+	{
+        book.clear();
+        if (page >= pages.size()) 
+		{
+            error = "no page " + to_string(page + 1);
+            return false;
+        }
+        uint64_t at = pages[page].logOffset;
+        uint64_t current = 0;
+        uint32_t orders = 0;
+        while (at < state.coveredEnd) 
+		{
+            uint16_t type, length;
+            const char* payload;
+            if (!OrderLog::frameAt(log.view(), at, type, payload, length)) 
+			{
+                error = "damaged frame at offset " + to_string(at);
+                return false;
+            }
+            if (type == OrderLog::FRAME_CHECKOUT) 
+			{
+                const OrderLogCheckout* checkout = (const OrderLogCheckout*)payload;
+                if (checkout->orderId != current) 
+				{
+                    if (orders == PAGE_ORDERS) 
+					{
+                        break;
+                    }
+                    ++orders;
+                    current = checkout->orderId;
+                }
+                OrderLogEntry entry;
+                entry.checkout = checkout;
+                entry.offset = at;
+                if (!stringAt(checkout->customerId, entry.customerName) || !stringAt(checkout->dineId, entry.dineOption)) 
+				{
+                    error = "unknown name in the checkout at offset " + to_string(at);
+                    return false;
+                }
+                const OrderLogLine* lines = (const OrderLogLine*)(checkout + 1);
+                for (uint32_t i = 0; i < checkout->lineCount; ++i) 
+				{
+                    entry.line = &lines[i];
+                    entry.lineIndex = i;
+                    if (!stringAt(lines[i].itemNameId, entry.foodDetails)) 
+					{
+                        error = "unknown name in the checkout at offset " + to_string(at);
+                        return false;
+                    }
+                    OrderLogReader::addTo(book, entry);
+                }
+            }
+            at += OrderLog::frameSize(length);
+        }
+        return true;
+    }
+
+private:
+    bool stringAt(uint32_t id, string_view& value) const 
+	{
+        uint16_t length;
+        const char* payload = id < stringOffsets.size() ? OrderLog::payloadAt(log.view(), stringOffsets[id], OrderLog::FRAME_STRING, length) : nullptr;
+        if (!payload || length < sizeof(uint32_t)) 
+		{
+            return false;
+        }
+        value = string_view(payload + sizeof(uint32_t), length - sizeof(uint32_t));
+        return true;
+    }
+
+    // Walks the frames after coveredEnd, up to the first one that is cut short
+    // or damaged. Returns true when anything was added.
+    bool extend() 
+	{
+        uint64_t start = state.coveredEnd;
+        uint64_t at = start;
+        uint16_t type, length;
+        const char* payload;
+        while (OrderLog::frameAt(log.view(), at, type, payload, length)) 
+		{
+            if (type == OrderLog::FRAME_STRING) 
+			{
+                uint32_t id;
+                if (length < sizeof(id)) 
+				{
+                    break;
+                }
+                memcpy(&id, payload, sizeof(id));
+                if (id != stringOffsets.size()) 
+				{
+                    break;
+                }
+                stringOffsets.push_back(at);
+            }
+            else if (type == OrderLog::FRAME_CHECKOUT) 
+			{
+                const OrderLogCheckout* checkout = (const OrderLogCheckout*)payload;
+                if (length < sizeof(OrderLogCheckout) || length != sizeof(OrderLogCheckout) + (size_t)checkout->lineCount * sizeof(OrderLogLine)) 
+				{
+                    break;
+                }
+                // A checkout too big for one frame continues in the next under the same id
+                if (state.orderCount == 0 || checkout->orderId != state.lastOrderId) 
+				{
+                    if (state.orderCount % PAGE_ORDERS == 0) 
+					{
+                        pages.push_back({at, checkout->orderTime});
+                    }
+                    ++state.orderCount;
+                    state.lastOrderId = checkout->orderId;
+                    state.totalCents += checkout->totalCents;
+                }
+            }
+            at += OrderLog::frameSize(length);
+        }
+        state.coveredEnd = at;
+        return at != start;
+    }
+
+    // Accepts the index only if it belongs to this log and still fits inside it
+    bool load(int64_t logCreatedAt) 
+	{
+        MappedFile file;
+        if (!file.open(indexPath) || file.size() < sizeof(OrderPageIndexHeader)) 
+		{
+            return false;
+        }
+        OrderPageIndexHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        uint64_t bytes = (uint64_t)header.pageCount * sizeof(OrderPageEntry) + (uint64_t)header.stringCount * sizeof(uint64_t);
+        if (memcmp(header.magic, "PSPAGEIX", 8) != 0 || header.version != VERSION || header.pageOrders != PAGE_ORDERS ||
+            header.logCreatedAt != logCreatedAt || header.coveredEnd > log.size() || file.size() != sizeof(header) + bytes) 
+		{
+            return false;
+        }
+        uint32_t checksum = Crc32c::compute(&header, offsetof(OrderPageIndexHeader, checksum));
+        if (Crc32c::compute(file.data() + sizeof(header), bytes, checksum) != header.checksum) 
+		{
+            return false;
+        }
+        pages.resize(header.pageCount);
+        stringOffsets.resize(header.stringCount);
+        const char* at = file.data() + sizeof(header);
+        memcpy(pages.data(), at, pages.size() * sizeof(OrderPageEntry));
+        memcpy(stringOffsets.data(), at + pages.size() * sizeof(OrderPageEntry), stringOffsets.size() * sizeof(uint64_t));
+        state = header;
+        return true;
+    }
+
+    // Written to a temporary file and renamed, so a crash leaves the old index
+    bool save() 
+	{
+        state.pageCount = (uint32_t)pages.size();
+        state.stringCount = (uint32_t)stringOffsets.size();
+        string body((const char*)pages.data(), pages.size() * sizeof(OrderPageEntry));
+        body.append((const char*)stringOffsets.data(), stringOffsets.size() * sizeof(uint64_t));
+        state.checksum = Crc32c::compute(&state, offsetof(OrderPageIndexHeader, checksum));
+        state.checksum = Crc32c::compute(body.data(), body.size(), state.checksum);
+
+        string tempPath = indexPath + ".tmp";
+        {
+            ofstream out(tempPath, ios::binary | ios::trunc);
+            out.write((const char*)&state, sizeof(state));
+            out.write(body.data(), body.size());
+            if (!out) 
+			{
+                return false;
+            }
+        }
+        error_code ec;
+        filesystem::rename(tempPath, indexPath, ec);
+        if (ec) 
+		{
+            filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+};
+
+// The orders with ids above a watermark, in log order. Order ids only grow
+// along the log, so with a usable manifest only the segments from the one
+// holding the watermark onwards are read; otherwise the whole history is
+// streamed and filtered.
+class NewOrderStream : public OrderStream 
+{
+private:
+    string logPath;
+    uint64_t after = 0;
+    uint64_t newest = 0;
+    vector<pair<uint64_t, uint64_t>> ranges;  // [begin, end) of the segments still to read
+    size_t nextRange = 0;
+    OrderLogReader reader;
+    bool reading = false;
+    bool fromSegments = false;
+    HistoryOrderStream all;
+
+public:
+    bool open(const string& path, const string& manifestPath, const string& textPath, uint64_t afterOrderId) 
+	{
+        logPath = path;
+        after = newest = afterOrderId;
+        ranges.clear();
+        nextRange = 0;
+        reading = false;
+        fromSegments = findSegments(manifestPath);
+        return fromSegments || all.open(path, textPath);
+    }
+
+    bool next(Order& order) override 
+	{
+        if (!fromSegments) 
+		{
+            while (all.next(order)) 
+			{
+                if (order.orderId > after) 
+				{
+                    newest = max(newest, order.orderId);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        OrderLogEntry entry;
+        while (true) 
+		{
+            if (!reading) 
+			{
+                if (nextRange == ranges.size()) 
+				{
+                    return false;
+                }
+                string error;
+                if (!reader.openSegment(logPath, ranges[nextRange].first, ranges[nextRange].second, error)) 
+				{
+                    cerr << logPath << ": " << error << ", history after it is skipped" << endl;
+                    return false;
+                }
+                ++nextRange;
+                reading = true;
+            }
+            if (reader.next(entry)) 
+			{
+                if (entry.checkout->orderId > after) 
+				{
+                    OrderLogReader::toOrder(entry, order);
+                    newest = max(newest, order.orderId);
+                    return true;
+                }
+                continue;
+            }
+            // The last segment may end in a torn append; anything else is damage
+            if (!reader.error().empty() && !(nextRange == ranges.size() && reader.isTruncated())) 
+			{
+                cerr << logPath << ": " << reader.error() << ", history after it is skipped" << endl;
+                return false;
+            }
+            reading = false;
+        }
+    }
+
+    // The highest order id handed out, or the watermark if there was none
+    uint64_t lastOrderId() const { return newest; }
+    // Log segments opened so far; zero when the history was streamed whole
+    size_t segmentsRead() const { return fromSegments ? nextRange : 0; }
+
+private:
+    // Works back from the newest segment to the first one that starts at or
+    // below the watermark, peeking at each one's first checkout
+    bool findSegments(const string& manifestPath) 
+	{
+        OrderLogReader probe;
+        string error;
+        vector<OrderSegment> segments;
+        if (!probe.open(logPath, error) || !OrderManifest::load(manifestPath, probe.header().createdAt, segments)) 
+		{
+            return false;
+        }
+        vector<pair<uint64_t, uint64_t>> all;
+        for (const OrderSegment& segment : segments) 
+		{
+            all.push_back({segment.begin, segment.end});
+        }
+        all.push_back({segments.empty() ? sizeof(OrderLogHeader) : segments.back().end, probe.fileSize()});
+
+        size_t first = all.size();
+        while (first > 0) 
+		{
+            const pair<uint64_t, uint64_t>& range = all[first - 1];
+            if (range.first < range.second) 
+			{
+                OrderLogReader peek;
+                OrderLogEntry entry;
+                if (!peek.openSegment(logPath, range.first, range.second, error)) 
+				{
+                    return false;
+                }
+                if (peek.next(entry) && entry.checkout->orderId <= after) 
+				{
+                    break;  // this segment holds the watermark
+                }
+            }
+            --first;
+        }
+        if (first == 0) 
+		{
+            first = 1;
+        }
+        ranges.assign(all.begin() + (first - 1), all.end());
+        return true;
+    }
+};
+
+// orders.csv.mark: the last order id an export holds and the size the export
+// had then. An incremental export appends only newer orders, and starts over
+// when the target no longer has the recorded size.
+struct ExportWatermarkData 
+{
+    char magic[8];         // "PSEXPMRK"
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t lastOrderId;
+    uint64_t targetSize;
+    uint32_t checksum;     // CRC-32C of the fields above
+    uint32_t padding;
+};
+
+static_assert(sizeof(ExportWatermarkData) == 40, "export watermark layout changed");
+
+class ExportWatermark 
+{
+public:
+    static const uint32_t VERSION = 1;
+
+    static string pathFor(const string& exportPath) { return exportPath + ".mark"; }
+
+    // False when there is no mark, it is damaged, or the export changed since
+    static bool load(const string& exportPath, uint64_t& lastOrderId) 
+	{
+        MappedFile file;
+        if (!file.open(pathFor(exportPath)) || file.size() != sizeof(ExportWatermarkData)) 
+		{
+            return false;
+        }
+        ExportWatermarkData mark;
+        memcpy(&mark, file.data(), sizeof(mark));
+        if (memcmp(mark.magic, "PSEXPMRK", 8) != 0 || mark.version != VERSION ||
+            mark.checksum != Crc32c::compute(&mark, offsetof(ExportWatermarkData, checksum))) 
+		{
+            return false;
+        }
+        error_code ec;
+        uint64_t size = filesystem::file_size(exportPath, ec);
+        if (ec || size != mark.targetSize) 
+		{
+            return false;
+        }
+        lastOrderId = mark.lastOrderId;
+        return true;
+    }
+
+    static bool save(const string& exportPath, uint64_t lastOrderId) 
+	{
+        ExportWatermarkData mark = {};
+        memcpy(mark.magic, "PSEXPMRK", 8);
+        mark.version = VERSION;
+        mark.lastOrderId = lastOrderId;
+        error_code ec;
+        mark.targetSize = filesystem::file_size(exportPath, ec);
+        if (ec) 
+		{
+            return false;
+        }
+        mark.checksum = Crc32c::compute(&mark, offsetof(ExportWatermarkData, checksum));
+
+        string path = pathFor(exportPath);
+        string tempPath = path + ".tmp";
+        {
+            ofstream out(tempPath, ios::binary | ios::trunc);
+            out.write((const char*)&mark, sizeof(mark));
+            if (!out) 
+			{
+                return false;
+            }
+        }
+        filesystem::rename(tempPath, path, ec);
+        if (ec) 
+		{
+            filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    static void discard(const string& exportPath) 
+	{
+        error_code ec;
+        filesystem::remove(pathFor(exportPath), ec);
+    }
+};
+
+// orders.col layout: "PSCOLUMN", the column data of every chunk, then the
+// metadata (column directory, chunk table, name dictionary) and a fixed footer
+// at the very end saying where the metadata is. A chunk holds whole checkouts.
+// Each column of a chunk is a run of LEB128 varints, zigzag-encoded so small
+// negative numbers stay short; names are stored as dictionary ids and order ids
+// and times as the difference from the previous row.
+struct ColumnarFooter 
+{
+    uint64_t rowCount;
+    uint64_t metadataOffset;
+    uint64_t metadataSize;
+    uint32_t version;
+    uint32_t columnCount;
+    uint32_t chunkCount;
+    uint32_t nameCount;
+    uint32_t checksum;     // CRC-32C of the metadata
+    uint32_t reserved;
+    char magic[8];         // "PSCOLEND"
+};
+
+// Column directory entry; the order of the directory is the order of the
+// columns in every chunk
+struct ColumnarColumnInfo 
+{
+    char name[16];         // NUL padded
+    uint32_t encoding;
+    uint32_t reserved;
+};
+
+// Where one column of one chunk is, with the smallest and largest value in it
+struct ColumnarChunkColumn 
+{
+    uint64_t offset;
+    uint64_t size;
+    int64_t min;
+    int64_t max;
+    uint32_t checksum;     // CRC-32C of the column bytes
+    uint32_t reserved;
+};
+
+// Chunk table entry: a row count followed by one ColumnarChunkColumn per column
+struct ColumnarChunkHeader 
+{
+    uint32_t rowCount;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ColumnarFooter) == 56, "orders.col footer layout changed");
+static_assert(sizeof(ColumnarColumnInfo) == 24, "orders.col column layout changed");
+static_assert(sizeof(ColumnarChunkColumn) == 40, "orders.col chunk column layout changed");
+static_assert(sizeof(ColumnarChunkHeader) == 8, "orders.col chunk layout changed");
+
+// The columnar export of the order history, for analytics that would otherwise
+// parse orders.csv. Chunks are encoded independently, so they can be built in
+// parallel and skipped by a reader whose predicate their min/max rules out.
+class ColumnarOrders 
+{
+public:
+    static const uint32_t VERSION = 1;
+    static const size_t CHUNK_ORDERS = 16384;  // checkouts per chunk
+
+    enum Column 
+    {
+        ORDER_ID,
+        ORDER_TIME,
+        CUSTOMER,
+        DINE_OPTION,
+        FOOD,
+        ITEM_ID,
+        QUANTITY,
+        PRICE_CENTS,
+        COLUMN_COUNT
+    };
+
+    enum Encoding 
+    {
+        VARINT = 1,      // zigzag varints
+        DELTA = 2,       // zigzag varints of the difference from the previous row
+        DICTIONARY = 3   // varint ids into the name dictionary
+    };
+
+    static const char* columnName(Column column) 
+	{
+        static const char* names[COLUMN_COUNT] = {"order_id", "order_time", "customer", "dine_option", "food", "item_id", "quantity", "price_cents"};
+        return names[column];
+    }
+
+    static Encoding columnEncoding(Column column) 
+	{
+        static const Encoding encodings[COLUMN_COUNT] = {DELTA, DELTA, DICTIONARY, DICTIONARY, DICTIONARY, VARINT, VARINT, VARINT};
+        return encodings[column];
+    }
+
+    // The chunk table entry of a chunk being written
+    struct ChunkEntry 
+	{
+        ColumnarChunkHeader header;
+        ColumnarChunkColumn columns[COLUMN_COUNT];
+    };
+
+    // Appends the columns of checkouts [first, end) to out. Column offsets are
+    // relative to the start of the chunk until finish() places it in the file.
+    static uint64_t encodeChunk(const OrderBook& book, size_t first, size_t end, string& out, ChunkEntry& entry) 
+	{
+        vector<int64_t> values[COLUMN_COUNT];
+        for (size_t i = first; i < end; ++i) 
+		{
+            const OrderHeader& header = book.orders[i];
+            for (uint32_t k = 0; k < header.lineCount; ++k) 
+			{
+                const OrderLine& line = book.lines[header.firstLine + k];
+                values[ORDER_ID].push_back((int64_t)header.orderId);
+                values[ORDER_TIME].push_back((int64_t)header.orderTime);
+                values[CUSTOMER].push_back(header.customerId);
+                values[DINE_OPTION].push_back(header.dineId);
+                values[FOOD].push_back(line.foodId);
+                values[ITEM_ID].push_back(line.itemId);
+                values[QUANTITY].push_back(line.quantity);
+                values[PRICE_CENTS].push_back(line.price.cents);
+            }
+        }
+
+        entry = {};
+        entry.header.rowCount = (uint32_t)values[ORDER_ID].size();
+        size_t start = out.size();
+        for (int c = 0; c < COLUMN_COUNT; ++c) 
+		{
+            ColumnarChunkColumn& column = entry.columns[c];
+            column.offset = out.size() - start;
+            if (!values[c].empty()) 
+			{
+                auto range = minmax_element(values[c].begin(), values[c].end());
+                column.min = *range.first;
+                column.max = *range.second;
+            }
+            Encoding encoding = columnEncoding((Column)c);
+            int64_t previous = 0;
+            for (int64_t value : values[c]) 
+			{
+                putVarint(out, encoding == DICTIONARY ? (uint64_t)value : zigzag(encoding == DELTA ? value - previous : value));
+                previous = value;
+            }
+            column.size = out.size() - start - column.offset;
+            column.checksum = Crc32c::compute(out.data() + start + column.offset, column.size);
+        }
+        return entry.header.rowCount;
+    }
+
+    // The metadata and footer that end the file, once chunks holding rowCount
+    // rows were written in order from dataStart on
+    static void finish(const OrderBook& book, vector<ChunkEntry>& chunks, uint64_t dataStart, uint64_t rowCount, string& out) 
+	{
+        uint64_t chunkStart = dataStart;
+        for (ChunkEntry& chunk : chunks) 
+		{
+            uint64_t chunkSize = 0;
+            for (ColumnarChunkColumn& column : chunk.columns) 
+			{
+                column.offset += chunkStart;
+                chunkSize += column.size;
+            }
+            chunkStart += chunkSize;
+        }
+
+        string metadata;
+        for (int c = 0; c < COLUMN_COUNT; ++c) 
+		{
+            ColumnarColumnInfo info = {};
+            strncpy(info.name, columnName((Column)c), sizeof(info.name) - 1);
+            info.encoding = columnEncoding((Column)c);
+            metadata.append((const char*)&info, sizeof(info));
+        }
+        metadata.append((const char*)chunks.data(), chunks.size() * sizeof(ChunkEntry));
+        for (size_t id = 0; id < book.names.size(); ++id) 
+		{
+            string_view name = book.names.name((uint32_t)id);
+            uint32_t length = (uint32_t)name.size();
+            metadata.append((const char*)&length, sizeof(length));
+            metadata.append(name.data(), name.size());
+        }
+
+        ColumnarFooter footer = {};
+        footer.rowCount = rowCount;
+        footer.metadataOffset = chunkStart;
+        footer.metadataSize = metadata.size();
+        footer.version = VERSION;
+        footer.columnCount = COLUMN_COUNT;
+        footer.chunkCount = (uint32_t)chunks.size();
+        footer.nameCount = (uint32_t)book.names.size();
+        footer.checksum = Crc32c::compute(metadata.data(), metadata.size());
+        memcpy(footer.magic, "PSCOLEND", 8);
+        out += metadata;
+        out.append((const char*)&footer, sizeof(footer));
+    }
+
+    static void putVarint(string& out, uint64_t value) 
+	{
+        char bytes[10];
+        size_t n = 0;
+        while (value >= 0x80) 
+		{
+            bytes[n++] = (char)(value | 0x80);
+            value >>= 7;
+        }
+        bytes[n++] = (char)value;
+        out.append(bytes, n);
+    }
+
+    // False when the varint runs past end or is longer than 64 bits allow
+    static bool getVarint(const char*& at, const char* end, uint64_t& value) 
+	{
+        value = 0;
+        for (int shift = 0; shift < 64 && at < end; shift += 7) 
+		{
+            uint8_t byte = (uint8_t)*at++;
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (byte < 0x80) 
+			{
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+    static int64_t unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+};
+
+// One decoded chunk of orders.col, a vector of values per column. Columns the
+// scan did not need are left empty.
+struct ColumnarChunk 
+{
+    size_t rows = 0;
+    vector<int64_t> values[ColumnarOrders::COLUMN_COUNT];
+
+    int64_t at(ColumnarOrders::Column column, size_t row) const { return values[column][row]; }
+};
+
+// Keeps rows whose column value lies in [min, max]
+struct ColumnarRange 
+{
+    ColumnarOrders::Column column;
+    int64_t min;
+    int64_t max;
+};
+
+// Reads orders.col over a read-only mapping. scan() pushes its predicates down:
+// chunks whose min/max rule a predicate out are never decoded, and in the rest
+// the other columns are only decoded once a row is known to match.
+class ColumnarOrderReader 
+{
+private:
+    MappedFile file;
+    ColumnarFooter footer = {};
+    int columnAt[ColumnarOrders::COLUMN_COUNT];  // directory position of each column
+    uint32_t encodings[ColumnarOrders::COLUMN_COUNT];
+    vector<ColumnarChunkHeader> chunkHeaders;
+    vector<ColumnarChunkColumn> chunkColumns;  // footer.columnCount per chunk
+    vector<string_view> names;
+    unordered_map<string_view, uint32_t> nameIds;
+    size_t decodedChunks = 0;
+    string lastError;
+
+public:
+    bool open(const string& path, string& error) 
+	{
+        close();
+        if (!file.open(path)) 
+		{
+            error = "cannot open " + path;
+            return false;
+        }
+        if (file.size() < 8 + sizeof(ColumnarFooter) || memcmp(file.data(), "PSCOLUMN", 8) != 0) 
+		{
+            error = "not a columnar order file";
+            return false;
+        }
+        memcpy(&footer, file.data() + file.size() - sizeof(footer), sizeof(footer));
+        if (memcmp(footer.magic, "PSCOLEND", 8) != 0) 
+		{
+            error = "file is truncated";
+            return false;
+        }
+        if (footer.version != ColumnarOrders::VERSION) 
+		{
+            error = "unsupported version " + to_string(footer.version);
+            return false;
+        }
+        uint64_t metadataEnd = file.size() - sizeof(footer);
+        if (footer.metadataOffset < 8 || footer.metadataOffset > metadataEnd || footer.metadataSize != metadataEnd - footer.metadataOffset) 
+		{
+            error = "metadata does not fit the file";
+            return false;
+        }
+        const char* metadata = file.data() + footer.metadataOffset;
+        if (Crc32c::compute(metadata, footer.metadataSize) != footer.checksum) 
+		{
+            error = "checksum mismatch";
+            return false;
+        }
+
+        // Column directory: find the columns this reader knows; others are skipped
+        uint64_t chunkEntry = sizeof(ColumnarChunkHeader) + (uint64_t)footer.columnCount * sizeof(ColumnarChunkColumn);
+        uint64_t tables = (uint64_t)footer.columnCount * sizeof(ColumnarColumnInfo) + footer.chunkCount * chunkEntry;
+        if (tables > footer.metadataSize) 
+		{
+            error = "metadata is truncated";
+            return false;
+        }
+        fill(begin(columnAt), end(columnAt), -1);
+        for (uint32_t i = 0; i < footer.columnCount; ++i) 
+		{
+            ColumnarColumnInfo info;
+            memcpy(&info, metadata + i * sizeof(info), sizeof(info));
+            string_view name(info.name, strnlen(info.name, sizeof(info.name)));
+            for (int c = 0; c < ColumnarOrders::COLUMN_COUNT; ++c) 
+			{
+                if (name == ColumnarOrders::columnName((ColumnarOrders::Column)c)) 
+				{
+                    columnAt[c] = (int)i;
+                    encodings[c] = info.encoding;
+                }
+            }
+        }
+        for (int c = 0; c < ColumnarOrders::COLUMN_COUNT; ++c) 
+		{
+            if (columnAt[c] < 0) 
+			{
+                error = string("missing column ") + ColumnarOrders::columnName((ColumnarOrders::Column)c);
+                return false;
+            }
+            if (encodings[c] < ColumnarOrders::VARINT || encodings[c] > ColumnarOrders::DICTIONARY) 
+			{
+                error = string("unknown encoding of column ") + ColumnarOrders::columnName((ColumnarOrders::Column)c);
+                return false;
+            }
+        }
+
+        // Chunk table
+        const char* at = metadata + (uint64_t)footer.columnCount * sizeof(ColumnarColumnInfo);
+        chunkHeaders.resize(footer.chunkCount);
+        chunkColumns.resize((size_t)footer.chunkCount * footer.columnCount);
+        uint64_t rows = 0;
+        for (uint32_t i = 0; i < footer.chunkCount; ++i) 
+		{
+            memcpy(&chunkHeaders[i], at, sizeof(ColumnarChunkHeader));
+            memcpy(&chunkColumns[(size_t)i * footer.columnCount], at + sizeof(ColumnarChunkHeader), footer.columnCount * sizeof(ColumnarChunkColumn));
+            at += chunkEntry;
+            rows += chunkHeaders[i].rowCount;
+            for (uint32_t c = 0; c < footer.columnCount; ++c) 
+			{
+                const ColumnarChunkColumn& column = chunkColumns[(size_t)i * footer.columnCount + c];
+                if (column.offset < 8 || column.offset > footer.metadataOffset || column.size > footer.metadataOffset - column.offset) 
+				{
+                    error = "chunk " + to_string(i) + " points outside the column data";
+                    return false;
+                }
+            }
+        }
+        if (rows != footer.rowCount) 
+		{
+            error = "row count does not match the chunks";
+            return false;
+        }
+
+        // Name dictionary
+        const char* end = metadata + footer.metadataSize;
+        names.reserve(footer.nameCount);
+        for (uint32_t i = 0; i < footer.nameCount; ++i) 
+		{
+            uint32_t length;
+            if (end - at < (ptrdiff_t)sizeof(length)) 
+			{
+                error = "name dictionary is truncated";
+                return false;
+            }
+            memcpy(&length, at, sizeof(length));
+            at += sizeof(length);
+            if ((uint64_t)(end - at) < length) 
+			{
+                error = "name dictionary is truncated";
+                return false;
+            }
+            names.emplace_back(at, length);
+            nameIds.emplace(names.back(), i);
+            at += length;
+        }
+        return true;
+    }
+
+    void close() 
+	{
+        file.close();
+        chunkHeaders.clear();
+        chunkColumns.clear();
+        names.clear();
+        nameIds.clear();
+        decodedChunks = 0;
+        lastError.clear();
+    }
+
+    uint64_t rowCount() const { return footer.rowCount; }
+    size_t chunkCount() const { return chunkHeaders.size(); }
+    // Chunks the scans so far had to decode
+    size_t chunksRead() const { return decodedChunks; }
+    const string& error() const { return lastError; }
+
+    string_view name(uint32_t id) const { return id < names.size() ? names[id] : string_view(); }
+
+    // The id a dictionary column stores for name, for use in a ColumnarRange
+    bool findName(string_view name, uint32_t& id) const 
+	{
+        auto it = nameIds.find(name);
+        if (it == nameIds.end()) 
+		{
+            return false;
+        }
+        id = it->second;
+        return true;
+    }
+
+    // Calls visit(chunk, row) for every row matching all of where, in file
+    // order. False, with error() set, when a chunk turns out to be damaged.
+    template <class Visit>
+    bool scan(const vector<ColumnarRange>& where, Visit visit) 
+	{
+        ColumnarChunk chunk;
+        vector<uint32_t> matches;
+        bool needed[ColumnarOrders::COLUMN_COUNT] = {};
+        for (const ColumnarRange& range : where) 
+		{
+            needed[range.column] = true;
+        }
+
+        for (size_t i = 0; i < chunkHeaders.size(); ++i) 
+		{
+            if (!mayMatch(i, where)) 
+			{
+                continue;
+            }
+            ++decodedChunks;
+            chunk.rows = chunkHeaders[i].rowCount;
+            for (auto& values : chunk.values) 
+			{
+                values.clear();
+            }
+            for (int c = 0; c < ColumnarOrders::COLUMN_COUNT; ++c) 
+			{
+                if (needed[c] && !decode(i, (ColumnarOrders::Column)c, chunk.values[c])) 
+				{
+                    return false;
+                }
+            }
+
+            matches.clear();
+            for (uint32_t row = 0; row < chunk.rows; ++row) 
+			{
+                bool keep = true;
+                for (const ColumnarRange& range : where) 
+				{
+                    int64_t value = chunk.values[range.column][row];
+                    keep = keep && value >= range.min && value <= range.max;
+                }
+                if (keep) 
+				{
+                    matches.push_back(row);
+                }
+            }
+            if (matches.empty()) 
+			{
+                continue;
+            }
+
+            for (int c = 0; c < ColumnarOrders::COLUMN_COUNT; ++c) 
+			{
+                if (!needed[c] && !decode(i, (ColumnarOrders::Column)c, chunk.values[c])) 
+				{
+                    return false;
+                }
+            }
+            for (uint32_t row : matches) 
+			{
+                visit(chunk, (size_t)row);
+            }
+        }
+        return true;
+    }
+
+    // The row as the flat Order the rest of the program displays
+    void toOrder(const ColumnarChunk& chunk, size_t row, Order& order) const 
+	{
+        string_view customer = name((uint32_t)chunk.at(ColumnarOrders::CUSTOMER, row));
+        string_view dine = name((uint32_t)chunk.at(ColumnarOrders::DINE_OPTION, row));
+        string_view food = name((uint32_t)chunk.at(ColumnarOrders::FOOD, row));
+        order.customerName.assign(customer.data(), customer.size());
+        order.dineOption.assign(dine.data(), dine.size());
+        order.foodDetails.assign(food.data(), food.size());
+        order.quantity = (int)chunk.at(ColumnarOrders::QUANTITY, row);
+        order.price = Money(chunk.at(ColumnarOrders::PRICE_CENTS, row));
+        order.parsedOrderTime = (time_t)chunk.at(ColumnarOrders::ORDER_TIME, row);
+        order.orderTime = OrderLog::timeText(order.parsedOrderTime);
+        order.totalPrice = order.quantity * order.price;
+        order.itemId = (uint32_t)chunk.at(ColumnarOrders::ITEM_ID, row);
+        order.orderId = (uint64_t)chunk.at(ColumnarOrders::ORDER_ID, row);
+    }
+
+private:
+    const ColumnarChunkColumn& columnOf(size_t chunk, ColumnarOrders::Column column) const 
+	{
+        return chunkColumns[chunk * footer.columnCount + columnAt[column]];
+    }
+
+    bool mayMatch(size_t chunk, const vector<ColumnarRange>& where) const 
+	{
+        for (const ColumnarRange& range : where) 
+		{
+            const ColumnarChunkColumn& column = columnOf(chunk, range.column);
+            if (chunkHeaders[chunk].rowCount == 0 || column.max < range.min || column.min > range.max) 
+			{
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool decode(size_t chunk, ColumnarOrders::Column column, vector<int64_t>& values) 
+	{
+        const ColumnarChunkColumn& info = columnOf(chunk, column);
+        const char* at = file.data() + info.offset;
+        const char* end = at + info.size;
+        if (Crc32c::compute(at, info.size) != info.checksum) 
+		{
+            lastError = "chunk " + to_string(chunk) + " is damaged";
+            return false;
+        }
+        uint32_t rows = chunkHeaders[chunk].rowCount;
+        bool delta = encodings[column] == ColumnarOrders::DELTA;
+        values.resize(rows);
+        int64_t previous = 0;
+        for (uint32_t row = 0; row < rows; ++row) 
+		{
+            uint64_t raw;
+            if (!ColumnarOrders::getVarint(at, end, raw)) 
+			{
+                lastError = "chunk " + to_string(chunk) + " is damaged";
+                return false;
+            }
+            int64_t value = encodings[column] == ColumnarOrders::DICTIONARY ? (int64_t)raw : ColumnarOrders::unzigzag(raw);
+            previous = delta ? previous + value : value;
+            values[row] = previous;
+        }
+        if (at != end) 
+		{
+            lastError = "chunk " + to_string(chunk) + " is damaged";
+            return false;
+        }
+        return true;
+    }
+};
+
+enum class OrderSortKey 
+{
+    Time,
+    Customer,
+    Item,
+    Total
+};
+
+// Sorts a stream of orders of any size within a memory budget. Orders are
+// collected until the budget is used up, sorted and spilled to a temporary run
+// file; the runs are then merged through a min-heap and handed out by next().
+// Equal keys keep their input order. When everything fits, nothing touches disk.
+class ExternalOrderSort : public OrderStream 
+{
+public:
+    static const size_t DEFAULT_MEMORY_BUDGET = 64u << 20;
+    static const size_t MAX_FAN_IN = 64;  // run files open at once during a merge
+
+private:
+    // A spilled run read back through its own buffer
+    struct RunReader 
+	{
+        ifstream in;
+        vector<char> buffer;
+    };
+
+    OrderSortKey key;
+    size_t budget;
+    string tempDir;
+    vector<string> runFiles;
+    vector<Order> memory;       // last, unspilled run
+    size_t memoryUsed = 0;
+    size_t memoryPosition = 0;
+    uint64_t spilled = 0;
+
+    vector<unique_ptr<RunReader>> readers;
+    vector<Order> heads;        // current order of each source; the last source is memory
+    vector<size_t> heap;        // source indexes, smallest head on top
+
+public:
+    ExternalOrderSort(OrderSortKey key, size_t memoryBudget = DEFAULT_MEMORY_BUDGET) 
+        : key(key), budget(max(memoryBudget, (size_t)1 << 20)) 
+	{
+        error_code ec;
+        filesystem::path dir = filesystem::temp_directory_path(ec);
+        tempDir = ec ? string(".") : dir.string();
+    }
+
+    ~ExternalOrderSort() 
+	{
+        readers.clear();
+        removeRuns(runFiles);
+    }
+
+    ExternalOrderSort(const ExternalOrderSort&) = delete;
+    ExternalOrderSort& operator=(const ExternalOrderSort&) = delete;
+
+    // Reads the whole input and prepares the sorted output. Returns false when a
+    // temporary run could not be written.
+    bool sort(OrderStream& input) 
+	{
+        Order order;
+        while (input.next(order)) 
+		{
+            memoryUsed += footprint(order);
+            memory.push_back(move(order));
+            if (memoryUsed >= budget && !spill()) 
+			{
+                return false;
+            }
+        }
+        stable_sort(memory.begin(), memory.end(), [this](const Order& a, const Order& b) { return less(a, b); });
+
+        // Merge down to a fan-in the heap can take in one pass. Each pass merges
+        // neighbouring runs and keeps the results in input order, because ties go
+        // to the earlier run and that is what keeps the sort stable.
+        while (runFiles.size() > MAX_FAN_IN) 
+		{
+            vector<string> merged;
+            for (size_t first = 0; first < runFiles.size(); first += MAX_FAN_IN) 
+			{
+                size_t count = min(size_t(MAX_FAN_IN), runFiles.size() - first);
+                if (count == 1) 
+				{
+                    merged.push_back(runFiles[first]);
+                    continue;
+                }
+                vector<string> group(runFiles.begin() + first, runFiles.begin() + first + count);
+                string target = newRunPath();
+                if (!mergeRuns(group, target)) 
+				{
+                    // Leave every remaining file listed so the destructor removes it
+                    removeRuns({target});
+                    merged.insert(merged.end(), runFiles.begin() + first, runFiles.end());
+                    runFiles = move(merged);
+                    return false;
+                }
+                removeRuns(group);
+                merged.push_back(target);
+            }
+            runFiles = move(merged);
+        }
+        return startMerge();
+    }
+
+    bool next(Order& order) override 
+	{
+        if (heap.empty()) 
+		{
+            return false;
+        }
+        pop_heap(heap.begin(), heap.end(), HeapOrder{this});
+        size_t source = heap.back();
+        heap.pop_back();
+        order = move(heads[source]);
+        if (advance(source)) 
+		{
+            heap.push_back(source);
+            push_heap(heap.begin(), heap.end(), HeapOrder{this});
+        }
+        return true;
+    }
+
+    // Orders written to temporary runs; 0 when everything fit in memory
+    uint64_t spilledOrders() const { return spilled; }
+    size_t runCount() const { return runFiles.size(); }
+
+private:
+    bool less(const Order& a, const Order& b) const 
+	{
+        switch (key) 
+		{
+            case OrderSortKey::Customer:
+                if (a.customerName != b.customerName) return a.customerName < b.customerName;
+                break;
+            case OrderSortKey::Item:
+                if (a.foodDetails != b.foodDetails) return a.foodDetails < b.foodDetails;
+                break;
+            case OrderSortKey::Total:
+                if (a.totalPrice != b.totalPrice) return a.totalPrice < b.totalPrice;
+                break;
+            case OrderSortKey::Time:
+                break;
+        }
+        return a.parsedOrderTime < b.parsedOrderTime;
+    }
+
+    // Orders the heap of source indexes; ties go to the earlier source, which keeps the sort stable
+    struct HeapOrder 
+	{
+        const ExternalOrderSort* sort;
+
+        bool operator()(size_t a, size_t b) const 
+		{
+            if (sort->less(sort->heads[a], sort->heads[b])) return false;
+            if (sort->less(sort->heads[b], sort->heads[a])) return true;
+            return a > b;
+        }
+    };
+
+    static size_t footprint(const Order& order) 
+	{
+        return sizeof(Order) + order.customerName.capacity() + order.dineOption.capacity() +
+               order.foodDetails.capacity() + order.orderTime.capacity();
+    }
+
+    string newRunPath() 
+	{
+        static atomic<uint64_t> counter{0};
+        uint64_t stamp = (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+        filesystem::path path = filesystem::path(tempDir) / ("psorders-" + to_string(stamp) + "-" + to_string(counter++) + ".run");
+        return path.string();
+    }
+
+    static void removeRuns(const vector<string>& paths) 
+	{
+        for (const string& path : paths) 
+		{
+            error_code ec;
+            filesystem::remove(path, ec);
+        }
+    }
+
+    bool spill() 
+	{
+        stable_sort(memory.begin(), memory.end(), [this](const Order& a, const Order& b) { return less(a, b); });
+        string path = newRunPath();
+        ofstream out(path, ios::binary | ios::trunc);
+        vector<char> buffer(1 << 20);
+        out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        for (const Order& order : memory) 
+		{
+            writeRecord(out, order);
+        }
+        out.close();
+        if (!out) 
+		{
+            cerr << "Failed to write sort run " << path << endl;
+            error_code ec;
+            filesystem::remove(path, ec);
+            return false;
+        }
+        runFiles.push_back(path);
+        spilled += memory.size();
+        memory.clear();
+        memory.shrink_to_fit();
+        memoryUsed = 0;
+        return true;
+    }
+
+    // Run record: time, unit price, quantity, item id, order id, then four length-prefixed strings
+    static void writeRecord(ostream& out, const Order& order) 
+	{
+        int64_t time = (int64_t)order.parsedOrderTime;
+        int64_t cents = order.price.cents;
+        int32_t quantity = order.quantity;
+        out.write((const char*)&time, sizeof(time));
+        out.write((const char*)&cents, sizeof(cents));
+        out.write((const char*)&quantity, sizeof(quantity));
+        out.write((const char*)&order.itemId, sizeof(order.itemId));
+        out.write((const char*)&order.orderId, sizeof(order.orderId));
+        for (const string* text : {&order.customerName, &order.dineOption, &order.foodDetails, &order.orderTime}) 
+		{
+            uint32_t length = (uint32_t)text->size();
+            out.write((const char*)&length, sizeof(length));
+            out.write(text->data(), length);
+        }
+    }
+
+    static bool readRecord(istream& in, Order& order) 
+	{
+        int64_t time, cents;
+        int32_t quantity;
+        if (!in.read((char*)&time, sizeof(time))) 
+		{
+            return false;
+        }
+        in.read((char*)&cents, sizeof(cents));
+        in.read((char*)&quantity, sizeof(quantity));
+        in.read((char*)&order.itemId, sizeof(order.itemId));
+        in.read((char*)&order.orderId, sizeof(order.orderId));
+        for (string* text : {&order.customerName, &order.dineOption, &order.foodDetails, &order.orderTime}) 
+		{
+            uint32_t length = 0;
+            in.read((char*)&length, sizeof(length));
+            text->resize(length);
+            in.read(&(*text)[0], length);
+        }
+        order.parsedOrderTime = (time_t)time;
+        order.price = Money(cents);
+        order.quantity = quantity;
+        order.totalPrice = order.quantity * order.price;
+        return (bool)in;
+    }
+
+    // Opens the runs (plus the in-memory remainder) and fills the heap with their first orders
+    bool openSources(const vector<string>& paths, bool withMemory) 
+	{
+        readers.clear();
+        heap.clear();
+        size_t sources = paths.size() + (withMemory ? 1 : 0);
+        heads.assign(sources, Order());
+        size_t bufferSize = max((size_t)64 << 10, budget / 2 / max(paths.size(), (size_t)1));
+        for (const string& path : paths) 
+		{
+            unique_ptr<RunReader> reader(new RunReader());
+            reader->buffer.resize(bufferSize);
+            reader->in.rdbuf()->pubsetbuf(reader->buffer.data(), reader->buffer.size());
+            reader->in.open(path, ios::binary);
+            if (!reader->in) 
+			{
+                cerr << "Failed to read sort run " << path << endl;
+                return false;
+            }
+            readers.push_back(move(reader));
+        }
+        memoryPosition = 0;
+        for (size_t source = 0; source < sources; ++source) 
+		{
+            if (advance(source)) 
+			{
+                heap.push_back(source);
+            }
+        }
+        make_heap(heap.begin(), heap.end(), HeapOrder{this});
+        return true;
+    }
+
+    // Loads the next order of a source into heads; false when it is used up
+    bool advance(size_t source) 
+	{
+        if (source < readers.size()) 
+		{
+            return readRecord(readers[source]->in, heads[source]);
+        }
+        if (memoryPosition >= memory.size()) 
+		{
+            return false;
+        }
+        heads[source] = move(memory[memoryPosition++]);
+        return true;
+    }
+
+    bool mergeRuns(const vector<string>& group, const string& target) 
+	{
+        if (!openSources(group, false)) 
+		{
+            return false;
+        }
+        ofstream out(target, ios::binary | ios::trunc);
+        vector<char> buffer(1 << 20);
+        out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        Order order;
+        while (next(order)) 
+		{
+            writeRecord(out, order);
+        }
+        readers.clear();
+        out.close();
+        if (!out) 
+		{
+            cerr << "Failed to write sort run " << target << endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool startMerge() 
+	{
+        return openSources(runFiles, true);
+    }
+};
+
+// Background persistence for the order history. Checkouts queue their orders; a
+// single writer thread drains everything queued, appends the text lines to
+// orders.txt and the binary frames to orders.log with one write call each and,
+// depending on the durability mode, syncs once for the batch.
+class OrderLogWriter 
+{
+public:
+    struct Record 
+	{
+        OrderBook checkout;
+        promise<bool>* done = nullptr;  // set when the caller waits for durability
+    };
+
+private:
+    static const size_t MAX_BATCH_BYTES = 1 << 20;
+
+    AppendFile textFile;
+    OrderLogAppender log;
+    atomic<bool> logEnabled{false};  // log.isOpen(), readable from other threads
+    Durability durability = Durability::Batch;
+    MpscQueue<Record> queue;
+    thread worker;
+    atomic<bool> sleeping{false};
+    atomic<bool> stopping{false};
+    mutex wakeLock;
+    condition_variable wake;
+
+public:
+    OrderLogWriter() {}
+    ~OrderLogWriter() { stop(); }
+
+    OrderLogWriter(const OrderLogWriter&) = delete;
+    OrderLogWriter& operator=(const OrderLogWriter&) = delete;
+
+    // Fails only when orders.txt cannot be opened; without orders.log the
+    // text history is still written
+    bool start(const string& textPath, const string& logPath, const string& indexPath, const string& manifestPath, Durability mode) 
+	{
+        stop();
+        if (!textFile.open(textPath)) 
+		{
+            return false;
+        }
+        string error;
+        if (!log.open(logPath, indexPath, manifestPath, error)) 
+		{
+            cerr << logPath << ": " << error << ", binary order log disabled" << endl;
+        }
+        else if (log.isNew()) 
+		{
+            importText(textPath);
+        }
+        logEnabled.store(log.isOpen());
+        durability = mode;
+        stopping.store(false);
+        worker = thread(&OrderLogWriter::run, this);
+        return true;
+    }
+
+    // Drains the queue, then joins the writer thread. Call before exit().
+    void stop() 
+	{
+        if (!worker.joinable()) 
+		{
+            return;
+        }
+        stopping.store(true);
+        {
+            lock_guard<mutex> lock(wakeLock);
+            wake.notify_one();
+        }
+        worker.join();
+        textFile.close();
+        log.close();
+        logEnabled.store(false);
+    }
+
+    bool isRunning() const { return worker.joinable(); }
+    // False once orders.log was disabled; orders.txt is then the only full history
+    bool logsOrders() const { return logEnabled.load(); }
+    Durability mode() const { return durability; }
+    // Safe to search from any thread while the writer runs
+    CustomerIndex& customers() { return log.customers(); }
+
+    // Queues one checkout; blocks until durable unless the mode is None.
+    // Returns false when the write or sync failed.
+    bool append(OrderBook checkout) 
+	{
+        if (!isRunning()) 
+		{
+            return false;
+        }
+        Record record;
+        record.checkout = move(checkout);
+        if (durability == Durability::None) 
+		{
+            push(move(record));
+            return true;
+        }
+        promise<bool> done;
+        future<bool> result = done.get_future();
+        record.done = &done;
+        push(move(record));
+        return result.get();
+    }
+
+    // The lines orders.txt holds for the checkouts in book, one per item
+    static void formatText(const OrderBook& book, string& out) 
+	{
+        for (const OrderHeader& header : book.orders) 
+		{
+            string time = OrderLog::timeText(header.orderTime);
+            for (uint32_t i = 0; i < header.lineCount; ++i) 
+			{
+                const OrderLine& line = book.lines[header.firstLine + i];
+                out.append(book.customerOf(header)).append(",").append(book.dineOptionOf(header)).append(",");
+                out.append(book.foodOf(line)).append(",").append(to_string(line.quantity)).append(",");
+                out.append(line.price.toString()).append(",").append(time).append("\n");
+            }
+        }
+    }
+
+private:
+    // A new orders.log starts with everything already in orders.txt
+    void importText(const string& textPath) 
+	{
+        OrderBook history;
+        if (!OrderHistoryLoader::loadText(textPath, history) || history.orders.empty()) 
+		{
+            return;
+        }
+        string frames, error;
+        if (!log.lock(error)) 
+		{
+            cerr << "Failed to import " << textPath << " into the binary order log: orders.log " << error << endl;
+            log.close();
+            return;
+        }
+        log.encode(history, frames);
+        bool written = log.write(frames) && log.sync();
+        log.unlock();
+        if (!written) 
+		{
+            cerr << "Failed to import " << textPath << " into the binary order log" << endl;
+            log.close();
+        }
+    }
+
+    void push(Record record) 
+	{
+        queue.push(move(record));
+        // Pairs with the store/pending() check in run(): one of the two sides
+        // always sees the other, so a wakeup is never lost
+        if (sleeping.load()) 
+		{
+            lock_guard<mutex> lock(wakeLock);
+            wake.notify_one();
+        }
+    }
+
+    // The frames are encoded only once the log is locked, after catching up
+    // with what other kiosks appended, so their ids follow the ones on disk
+    bool writeBatch(const string& text, const vector<OrderBook>& checkouts, string& frames, bool sync) 
+	{
+        bool ok = textFile.write(text.data(), text.size()) && (!sync || textFile.sync());
+        if (!log.isOpen()) 
+		{
+            return ok;
+        }
+        string error;
+        if (!log.lock(error)) 
+		{
+            cerr << "orders.log " << error << ", binary order log disabled" << endl;
+            disableLog();
+            return ok;
+        }
+        frames.clear();
+        for (const OrderBook& checkout : checkouts) 
+		{
+            log.encode(checkout, frames);
+        }
+        bool written = log.write(frames) && (!sync || log.sync());
+        log.unlock();
+        if (!written) 
+		{
+            // Later frames could refer to strings that never reached the disk
+            cerr << "Failed to write orders.log, binary order log disabled" << endl;
+            disableLog();
+        }
+        return ok;
+    }
+
+    void disableLog() 
+	{
+        log.close();
+        logEnabled.store(false);
+    }
+
+    void run() 
+	{
+        string text, frames;
+        vector<OrderBook> checkouts;
+        vector<promise<bool>*> waiting;
+        Record record;
+
+        while (true) 
+		{
+            text.clear();
+            checkouts.clear();
+            waiting.clear();
+            bool ok = true;
+
+            while (text.size() < MAX_BATCH_BYTES) 
+			{
+                if (!queue.pop(record)) 
+				{
+                    if (!queue.pending()) break;
+                    this_thread::yield();  // a producer is halfway through push()
+                    continue;
+                }
+                formatText(record.checkout, text);
+                checkouts.push_back(move(record.checkout));
+                if (durability == Durability::PerOrder) 
+				{
+                    // Each order gets its own write and sync
+                    bool written = writeBatch(text, checkouts, frames, true);
+                    if (record.done) record.done->set_value(written);
+                    ok = ok && written;
+                    text.clear();
+                    checkouts.clear();
+                    continue;
+                }
+                if (record.done) waiting.push_back(record.done);
+            }
+
+            if (!text.empty()) 
+			{
+                ok = writeBatch(text, checkouts, frames, durability == Durability::Batch);
+            }
+            for (promise<bool>* done : waiting) 
+			{
+                done->set_value(ok);
+            }
+            if (!ok) 
+			{
+                cerr << "Failed to write orders.txt" << endl;
+            }
+
+            if (queue.pending()) 
+			{
+                continue;
+            }
+            if (stopping.load()) 
+			{
+                break;
+            }
+
+            unique_lock<mutex> lock(wakeLock);
+            sleeping.store(true);
+            wake.wait(lock, [this] { return queue.pending() || stopping.load(); });
+            sleeping.store(false);
+        }
+    }
+};
+
+class FastFoodOrderingSystem 
+{
+private:
+    MenuCatalog catalog;  // the only copy of the menu items
+    MenuIndex menuIndex;  // sorted views and search indexes over menu, rebuilt whenever menu changes
+    MenuOrder menuOrder = MenuOrder::Original;  // view shown to the customer
+    NamePrefixIndex nameIndex;  // autocomplete over item names, kept current by the Admin edit functions
+    vector<OrderItem> orders;
+    OrderLogWriter orderWriter;  // appends checkouts to orders.txt and orders.log off the UI thread
+    size_t sortMemoryBudget = ExternalOrderSort::DEFAULT_MEMORY_BUDGET;  // memory an on-disk history sort may use
+    Stack orderHistory;
+    //stack<string> orderHistory; // Stack to store order history
+    string customerName;
+
+    void loadMenu() 
+	{
+        vector<MenuItem> items;
+        catalog.clear();
+        readMenuFiles(items);
+        catalog.assign(move(items));
+        menuIndex.build(catalog.items());
+        nameIndex.build(catalog.items());
+    }
+
+    void readMenuFiles(vector<MenuItem>& menu) 
+	{
+        // Prefer the binary image; fall back to parsing menu.txt if it is missing, stale or damaged
+        string imageError;
+        if (MenuImage::load("menu.bin", "menu.txt", catalog.image(), menu, imageError)) 
+		{
+            return;
+        }
+        catalog.image().close();
+        if (!imageError.empty()) 
+		{
+            cerr << "Ignoring menu.bin: " << imageError << endl;
+        }
+
+        vector<MenuLoadError> errors;
+        if (!MenuLoader::load("menu.txt", catalog.strings(), menu, errors)) 
+		{
+            cerr << "Failed to open menu.txt" << endl;
+        }
+        for (const auto& error : errors) 
+		{
+            if (error.line > 0) 
+			{
+                cerr << "menu.txt:" << error.line << ": " << error.message << " (line skipped)" << endl;
+            }
+        }
+
+        if (errors.empty()) 
+		{
+            MenuImage::write("menu.bin", "menu.txt", menu);
+        }
+    }
+
+    // Name autocomplete, falling back to typo-tolerant matching when no name starts with the text
+    vector<MenuItem> findItemsByName(const string& text, size_t limit) 
+	{
+        vector<MenuItem> results = SearchItem::searchByName(catalog, nameIndex, text, limit);
+        if (results.empty()) 
+		{
+            results = SearchItem::searchFuzzy(catalog.items(), menuIndex, text, limit);
+        }
+        return results;
+    }
 
     void displayMenu(const vector<MenuItem>& menu) 
+	{
+        displayMenu(menu, Algorithm::identity(menu.size()));
+    }
+
+    void displayMenu(const vector<MenuItem>& menu, const vector<int>& order) 
 	{
         cout << "-----------------------------------------------------------------------------"<< endl;
         cout << "Food code | Food name                         | Food type      | Food Price" << endl;
         cout << "-----------------------------------------------------------------------------"<< endl;
 
-        for (const auto& item : menu) 
+        for (int pos : order) 
 		{
+            const MenuItem& item = menu[pos];
             cout << setw(9) << left << item.code << " | "
                  << setw(33) << left << item.name << " | "
                  << setw(14) << left << item.category << " | RM "
-                 << fixed << setprecision(2) << item.price << endl;
+                 << item.price << endl;
         }
 
         cout << "-----------------------------------------------------------------------------" << endl;
@@ -419,290 +6545,545 @@ private:
 
     
 	void recordOrder(const string& customerName, const string& dineOption) {
-    ofstream orderFile("orders.txt", ios::app);
-    if (!orderFile) {
-        cerr << "Failed to open orders.txt" << endl;
-        return;
-    }
-
     auto now = chrono::system_clock::now();
     time_t orderTime = chrono::system_clock::to_time_t(now);
     string orderTimeStr = ctime(&orderTime);
 
-    // Write each order to file and push it to the stack
+    // Push each order to the stack
+    OrderBook checkout;
+    checkout.addOrder(0, customerName, dineOption, orderTime);
     for (const auto& orderItem : orders) {
-        Order order = {customerName, dineOption, orderItem.item, orderItem.quantity, orderItem.price, orderTimeStr, orderTime, orderItem.quantity * orderItem.price};
-        
-        // Write to file
-        orderFile << customerName << "," << dineOption << "," << order.foodDetails << "," << order.quantity << "," << order.price << "," << order.orderTime;
+        Order order = {customerName, dineOption, orderItem.item, orderItem.quantity, orderItem.price, orderTimeStr, orderTime, orderItem.quantity * orderItem.price, orderItem.itemId};
         
-        // Push to stack
         orderHistory.push(order);
+        checkout.addLine(orderItem.item, orderItem.itemId, orderItem.quantity, orderItem.price);
     }
 
-    orderFile.close();
+    // The writer thread appends it to orders.txt and orders.log together with any other queued checkouts
+    if (!orders.empty() && !orderWriter.append(move(checkout))) {
+        cerr << "Failed to save the order to orders.txt" << endl;
+    }
 }
 
 
 void searchOrderByCustomerName() 
 {
-    ifstream orderFile("history.txt");
-    if (!orderFile) 
+    // Prompt admin to enter customer name
+    string searchName;
+    cout << "Enter customer name to search: ";
+    cin.ignore();
+    getline(cin, searchName);
+
+    // customers.idx leads straight to the customer's rows; without it, read only the
+    // log segments whose name filter admits the customer
+    vector<Order> matches;
+    size_t segmentsRead = 0;
+    if (!orderWriter.customers().find(searchName, matches) &&
+        !OrderHistoryLoader::loadCustomer("orders.log", "orders.manifest", "orders.txt", orderWriter.logsOrders(), searchName, matches, segmentsRead)) 
 	{
-        cerr << "Failed to open history.txt" << endl;
+        cerr << "Failed to open orders.txt" << endl;
         return;
     }
 
-    unordered_map<string, vector<string>> orderMap;
-    string line;
-
-    // Build the hash map
-    while (getline(orderFile, line)) 
+    if (!matches.empty()) 
 	{
-        stringstream ss(line);
-        string customerName, dineOption, foodDetails, orderTime;
-        int quantity;
-        double price;
-
-        getline(ss, customerName, ',');
-        getline(ss, dineOption, ',');
-        getline(ss, foodDetails, ',');
-        ss >> quantity;
-        ss.ignore(); // Ignore the comma after quantity
-        ss >> price;
-        ss.ignore(); // Ignore the comma after price
-        getline(ss, orderTime);
+    	cout << "----------------------------------------------------------------------------------------------------------------" << endl;
+        cout << "Order History for " << searchName << ":" << endl;
+        cout << "----------------------------------------------------------------------------------------------------------------" << endl;
+        cout << setw(10) << left << "Order" << setw(20) << left << "Dine Option" << setw(30) << left << "Food Details" << setw(10) << left << "Quantity" << setw(10) << left << "Price" << "Order Time" << endl;
 
-        string orderDetails = dineOption + "," + foodDetails + "," + to_string(quantity) + "," + to_string(price) + "," + orderTime;
-        orderMap[customerName].push_back(orderDetails);
+        // Rows of one checkout arrive together; only the first shows the order, dine option and time
+        for (size_t i = 0; i < matches.size(); ++i) 
+		{
+            const Order& order = matches[i];
+            bool first = i == 0 || order.orderId == 0 || order.orderId != matches[i - 1].orderId;
+            cout << setw(10) << left << (first && order.orderId != 0 ? to_string(order.orderId) : "")
+                 << setw(20) << left << (first ? (order.dineOption == "t" ? "Take away" : "Dine in") : "")
+                 << setw(30) << left << order.foodDetails << setw(10) << left << order.quantity << setw(10) << left << order.price
+                 << (first ? order.orderTime : "") << endl;
+        }
+        cout << "----------------------------------------------------------------------------------------------------------------" << endl;
+    } 
+	else 
+	{
+        cout << "No order history found for customer: " << searchName << endl;
     }
+}
 
-    orderFile.close();
 
-    // Prompt admin to enter customer name
-    string searchName;
-    cout << "Enter customer name to search: ";
+void searchOrderByItem() 
+{
+    string item;
+    cout << "Enter food item to search: ";
     cin.ignore();
-    getline(cin, searchName);
+    getline(cin, item);
+
+    vector<Order> matches;
+    size_t segmentsRead = 0;
+    if (!OrderHistoryLoader::loadItem("orders.log", "orders.manifest", "orders.txt", orderWriter.logsOrders(), item, matches, segmentsRead)) 
+	{
+        cerr << "Failed to open orders.txt" << endl;
+        return;
+    }
 
-    if (orderMap.find(searchName) != orderMap.end()) 
+    if (!matches.empty()) 
 	{
     	cout << "----------------------------------------------------------------------------------------------------------------" << endl;
-        cout << "Order History for " << searchName << ":" << endl;
+        cout << "Orders of " << item << ":" << endl;
         cout << "----------------------------------------------------------------------------------------------------------------" << endl;
-        cout << setw(20) << left << "Dine Option" << setw(30) << left << "Food Details" << setw(10) << left << "Quantity" << setw(10) << left << "Price" << "Order Time" << endl;
+        cout << setw(20) << left << "Customer name" << setw(20) << left << "Dine Option" << setw(10) << left << "Quantity" << setw(10) << left << "Price" << "Order Time" << endl;
 
-        for (const auto& order : orderMap[searchName]) 
+        int sold = 0;
+        for (const auto& order : matches) 
 		{
-            stringstream ss(order);
-            string dineOption, foodDetails, orderTime;
-            int quantity;
-            double price;
-
-            getline(ss, dineOption, ',');
-            getline(ss, foodDetails, ',');
-            ss >> quantity;
-            ss.ignore(); // Ignore the comma after quantity
-            ss >> price;
-            ss.ignore(); // Ignore the comma after price
-            getline(ss, orderTime);
-
-            cout << setw(20) << left << (dineOption == "t" ? "Take away" : "Dine in") << setw(30) << left << foodDetails << setw(10) << left << quantity << setw(10) << left << fixed << setprecision(2) << price << orderTime << endl;
+            cout << setw(20) << left << order.customerName << setw(20) << left << (order.dineOption == "t" ? "Take away" : "Dine in") << setw(10) << left << order.quantity << setw(10) << left << order.price << order.orderTime << endl;
+            sold += order.quantity;
         }
         cout << "----------------------------------------------------------------------------------------------------------------" << endl;
+        cout << sold << " sold in " << matches.size() << " orders" << endl;
     } 
 	else 
 	{
-        cout << "No order history found for customer: " << searchName << endl;
+        cout << "No orders found for item: " << item << endl;
+    }
+}
+
+
+// Reorders orders so that orders[i] becomes the old orders[rows[i]], moving each
+// element once around its cycle instead of copying the vector
+template <class Row>
+void applyPermutation(vector<Row> &orders, vector<uint32_t> rows) 
+{
+    for (size_t start = 0; start < rows.size(); ++start) 
+    {
+        if (rows[start] == start) 
+        {
+            continue;
+        }
+        Row held = move(orders[start]);
+        size_t at = start;
+        while (rows[at] != start) 
+        {
+            size_t next = rows[at];
+            orders[at] = move(orders[next]);
+            rows[at] = (uint32_t)at;
+            at = next;
+        }
+        orders[at] = move(held);
+        rows[at] = (uint32_t)at;
     }
 }
 
+static void appendPadded(string &out, string_view field, size_t width) 
+{
+    out.append(field.data(), field.size());
+    if (field.size() < width) 
+    {
+        out.append(width - field.size(), ' ');
+    }
+}
 
-void merge(vector<Order> &arr, int left, int mid, int right) 
+static void appendNumber(string &out, int64_t value, size_t width = 0) 
 {
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
+    char text[24];
+    char *end = to_chars(text, text + sizeof(text), value).ptr;
+    appendPadded(out, string_view(text, end - text), width);
+}
 
-    vector<Order> L(n1);
-    vector<Order> R(n2);
+static void appendMoney(string &out, Money amount, size_t width = 0) 
+{
+    char text[32];
+    char *end = amount.format(text, text + sizeof(text));
+    appendPadded(out, string_view(text, end - text), width);
+}
 
-    for (int i = 0; i < n1; i++)
-        L[i] = arr[left + i];
-    for (int i = 0; i < n2; i++)
-        R[i] = arr[mid + 1 + i];
+static string_view dineOptionText(const Order &order) 
+{
+    return order.dineOption == "t" ? "Take away" : "Dine in";
+}
 
-    int i = 0, j = 0, k = left;
-    while (i < n1 && j < n2) 
-	{
-        if (L[i] < R[j])
-		{
-            arr[k] = L[i];
-            i++;
-        } 
-		else 
-		{
-            arr[k] = R[j];
-            j++;
+// One line of orders.csv
+static void appendCsvRow(string &out, const Order &order) 
+{
+    out.append(order.customerName).append(1, ',');
+    appendPadded(out, dineOptionText(order), 0);
+    out.append(1, ',').append(order.foodDetails).append(1, ',');
+    appendNumber(out, order.quantity);
+    out.append(1, ',');
+    appendMoney(out, order.price);
+    out.append(1, ',');
+    appendMoney(out, order.totalPrice);
+    out.append(1, ',').append(order.orderTime).append(1, '\n');
+}
+
+// One line of the table in orders.doc and orders_export.txt
+static void appendTableRow(string &out, const Order &order) 
+{
+    appendPadded(out, order.customerName, 20);
+    appendPadded(out, dineOptionText(order), 15);
+    appendPadded(out, order.foodDetails, 30);
+    appendNumber(out, order.quantity, 10);
+    appendMoney(out, order.price, 10);
+    appendMoney(out, order.totalPrice, 15);
+    out.append(order.orderTime).append(1, '\n');
+}
+
+static string tableHeading() 
+{
+    string heading = "Order History:\n"
+                     "-----------------------------------------------------------------------------------------------------------------------------------\n";
+    appendPadded(heading, "Customer name", 20);
+    appendPadded(heading, "Dine Option", 15);
+    appendPadded(heading, "Food Details", 30);
+    appendPadded(heading, "Quantity", 10);
+    appendPadded(heading, "Price", 10);
+    appendPadded(heading, "Total Price", 15);
+    heading += "Order Time\n"
+               "-----------------------------------------------------------------------------------------------------------------------------------\n";
+    return heading;
+}
+
+typedef void (*RowFormat)(string &, const Order &);
+
+// Formats pieces [0, count) into separate buffers on the shared pool, a window
+// of a few pieces per thread at a time, and writes the buffers in piece order.
+// format(i, out) appends piece i to out and returns its row count.
+static bool writePieces(ExportFile &outFile, size_t count, const function<uint64_t(size_t, string &)> &format) 
+{
+    ThreadPool &pool = ThreadPool::shared();
+    size_t window = pool.size() * 2;
+    vector<string> buffers(min(window, count));
+    vector<uint64_t> rows(buffers.size());
+    for (size_t first = 0; first < count; first += window) 
+    {
+        size_t pieces = min(window, count - first);
+        pool.run(pieces, [&](size_t i) 
+        {
+            buffers[i].clear();
+            rows[i] = format(first + i, buffers[i]);
+        });
+        for (size_t i = 0; i < pieces; ++i) 
+        {
+            if (!outFile.write(buffers[i], rows[i])) 
+            {
+                return false;
+            }
         }
-        k++;
     }
+    return true;
+}
 
-    while (i < n1) 
-	{
-        arr[k] = L[i];
-        i++;
-        k++;
+static bool finishExport(ExportFile &outFile, bool ok, const string &path) 
+{
+    if (!outFile.close() || !ok) 
+    {
+        cerr << "Failed to write " << path << endl;
+        return false;
     }
+    cout << outFile.rowCount() << " rows have been exported to " << path << endl;
+    return true;
+}
 
-    while (j < n2) 
-	{
-        arr[k] = R[j];
-        j++;
-        k++;
+// Streams orders into outFile. Rows are read in batches and each batch is
+// formatted in pieces on the thread pool.
+static bool writeOrders(OrderStream &orders, ExportFile &outFile, RowFormat format) 
+{
+    bool ok = true;
+    if (ThreadPool::shared().size() == 1) 
+    {
+        // With nothing to run beside, batching would only add a copy
+        Order order;
+        while (ok && orders.next(order)) 
+        {
+            format(outFile.out(), order);
+            ok = outFile.endRow();
+        }
+        return ok;
+    }
+
+    size_t pieceRows = ExportFile::PIECE_ROWS;
+    vector<Order> batch(ThreadPool::shared().size() * 2 * pieceRows);
+    bool more = true;
+    while (ok && more) 
+    {
+        size_t filled = 0;
+        while (filled < batch.size() && (more = orders.next(batch[filled]))) 
+        {
+            ++filled;
+        }
+        ok = writePieces(outFile, (filled + pieceRows - 1) / pieceRows, [&](size_t piece, string &out) 
+        {
+            size_t end = min(filled, (piece + 1) * pieceRows);
+            for (size_t i = piece * pieceRows; i < end; ++i) 
+            {
+                format(out, batch[i]);
+            }
+            return (uint64_t)(end - piece * pieceRows);
+        });
     }
+    return ok;
 }
 
-void mergeSort(vector<Order> &arr, int left, int right) 
+static void exportOrders(OrderStream &orders, const string &path, const string &heading, RowFormat format) 
 {
-    if (left >= right)
+    ExportFile outFile;
+    if (!outFile.open(path)) 
+    {
+        cerr << "Failed to create " << path << endl;
         return;
-    
-    int mid = left + (right - left) / 2;
-    mergeSort(arr, left, mid);
-    mergeSort(arr, mid + 1, right);
-    merge(arr, left, mid, right);
+    }
+    outFile.out() += heading;
+    bool ok = writeOrders(orders, outFile, format);
+    finishExport(outFile, ok, path);
 }
 
-void exportToCSV(const vector<Order> &orders) {
-    ofstream outFile("orders.csv");
-    if (!outFile) {
-        cerr << "Failed to create orders.csv" << endl;
+// Appends the orders placed since the last export of path, or rewrites it
+// from the whole history when there is no usable watermark. Only the log
+// segments holding new orders are read.
+static void exportNewOrders(const string &path, const string &heading, RowFormat format) 
+{
+    uint64_t lastOrderId = 0;
+    bool append = ExportWatermark::load(path, lastOrderId);
+    if (!append) 
+    {
+        cout << "No earlier export of " << path << " to continue, writing the whole history" << endl;
+    }
+
+    NewOrderStream orders;
+    if (!orders.open("orders.log", "orders.manifest", "orders.txt", lastOrderId)) 
+    {
+        cerr << "Failed to open orders.txt" << endl;
+        return;
+    }
+    ExportFile outFile;
+    if (!outFile.open(path, append)) 
+    {
+        cerr << "Failed to create " << path << endl;
         return;
     }
+    if (!append) 
+    {
+        outFile.out() += heading;
+    }
+    bool ok = writeOrders(orders, outFile, format);
+    if (finishExport(outFile, ok, path) && !ExportWatermark::save(path, orders.lastOrderId())) 
+    {
+        cerr << "Failed to record the export watermark, the next export will rewrite " << path << endl;
+    }
+    if (orders.segmentsRead() > 0) 
+    {
+        cout << "(" << orders.segmentsRead() << " log segment" << (orders.segmentsRead() == 1 ? "" : "s") << " read)" << endl;
+    }
+}
 
-    outFile << "Customer name,Dine Option,Food Details,Quantity,Price,Total Price,Order Time" << endl;
-    for (const auto &order : orders) {
-        outFile << order.customerName << ','
-                << (order.dineOption == "t" ? "Take away" : "Dine in") << ','
-                << order.foodDetails << ','
-                << order.quantity << ','
-                << fixed << setprecision(2) << order.price << ','
-                << fixed << setprecision(2) << order.totalPrice << ','
-                << order.orderTime << endl;
+// Exports a loaded history. Each piece is a run of checkouts that a worker
+// expands into rows and formats on its own, so nothing is read sequentially.
+static bool exportOrders(const OrderBook &book, const string &path, const string &heading, RowFormat format) 
+{
+    ExportFile outFile;
+    if (!outFile.open(path)) 
+    {
+        cerr << "Failed to create " << path << endl;
+        return false;
     }
 
-    outFile.close();
-    cout << "Orders have been exported to orders.csv" << endl;
+    outFile.out() += heading;
+    size_t pieceOrders = ExportFile::PIECE_ROWS;
+    size_t pieces = (book.orders.size() + pieceOrders - 1) / pieceOrders;
+    bool ok = writePieces(outFile, pieces, [&](size_t piece, string &out) 
+    {
+        size_t end = min(book.orders.size(), (piece + 1) * pieceOrders);
+        uint64_t rows = 0;
+        Order order;
+        for (size_t i = piece * pieceOrders; i < end; ++i) 
+        {
+            const OrderHeader &header = book.orders[i];
+            for (uint32_t line = 0; line < header.lineCount; ++line) 
+            {
+                book.row(header, line, order);
+                format(out, order);
+            }
+            rows += header.lineCount;
+        }
+        return rows;
+    });
+    return finishExport(outFile, ok, path);
+}
+
+static const char *csvHeading() 
+{
+    return "Customer name,Dine Option,Food Details,Quantity,Price,Total Price,Order Time\n";
+}
+
+// A full export in another order leaves no watermark, so the next
+// incremental export starts over
+void exportToCSV(OrderStream &orders) {
+    ExportWatermark::discard("orders.csv");
+    exportOrders(orders, "orders.csv", csvHeading(), appendCsvRow);
+}
+
+void exportToWord(OrderStream &orders) {
+    exportOrders(orders, "orders.doc", tableHeading(), appendTableRow);
+}
+
+void exportToText(OrderStream &orders) {
+    exportOrders(orders, "orders_export.txt", tableHeading(), appendTableRow);
 }
 
-void exportToWord(const vector<Order> &orders) {
-    ofstream outFile("orders.doc");
-    if (!outFile) {
-        cerr << "Failed to create orders.doc" << endl;
+// Writes orders.col: the chunks are encoded in parallel like the text exports,
+// then the metadata and footer follow
+void exportToColumnar(const OrderBook &book) {
+    const string path = "orders.col";
+    ExportFile outFile;
+    if (!outFile.open(path)) 
+    {
+        cerr << "Failed to create " << path << endl;
         return;
     }
 
-    outFile << "Order History:" << endl;
-    outFile << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
-    outFile << setw(20) << left << "Customer name" << setw(15) << left << "Dine Option" 
-            << setw(30) << left << "Food Details" << setw(10) << left << "Quantity" 
-            << setw(10) << left << "Price" << setw(15) << left << "Total Price" << "Order Time" << endl;
-    outFile << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    outFile.out() += "PSCOLUMN";
+    size_t chunkOrders = ColumnarOrders::CHUNK_ORDERS;
+    vector<ColumnarOrders::ChunkEntry> chunks((book.orders.size() + chunkOrders - 1) / chunkOrders);
+    bool ok = writePieces(outFile, chunks.size(), [&](size_t chunk, string &out) 
+    {
+        size_t first = chunk * chunkOrders;
+        return ColumnarOrders::encodeChunk(book, first, min(book.orders.size(), first + chunkOrders), out, chunks[chunk]);
+    });
+    if (ok) 
+    {
+        string metadata;
+        ColumnarOrders::finish(book, chunks, 8, outFile.rowCount(), metadata);
+        ok = outFile.write(metadata, 0);
+    }
+    finishExport(outFile, ok, path);
+}
 
-    for (const auto &order : orders) {
-        outFile << setw(20) << left << order.customerName
-                << setw(15) << left << (order.dineOption == "t" ? "Take away" : "Dine in")
-                << setw(30) << left << order.foodDetails
-                << setw(10) << left << order.quantity
-                << setw(10) << left << fixed << setprecision(2) << order.price
-                << setw(15) << left << fixed << setprecision(2) << order.totalPrice
-                << order.orderTime << endl;
+// A full export of the history; it holds every order id, so incremental
+// exports carry on after the highest one
+void exportToCSV(const OrderBook &book) {
+    ExportWatermark::discard("orders.csv");
+    if (exportOrders(book, "orders.csv", csvHeading(), appendCsvRow)) 
+    {
+        uint64_t lastOrderId = 0;
+        for (const OrderHeader &header : book.orders) 
+        {
+            lastOrderId = max(lastOrderId, header.orderId);
+        }
+        ExportWatermark::save("orders.csv", lastOrderId);
     }
+}
 
-    outFile.close();
-    cout << "Orders have been exported to orders.doc" << endl;
+void exportNewOrdersToCSV() {
+    exportNewOrders("orders.csv", csvHeading(), appendCsvRow);
 }
 
-void exportToText(const vector<Order> &orders) {
-    ofstream outFile("orders_export.txt");
-    if (!outFile) {
-        cerr << "Failed to create orders_export.txt" << endl;
-        return;
-    }
+void exportToWord(const OrderBook &book) {
+    exportOrders(book, "orders.doc", tableHeading(), appendTableRow);
+}
 
-    outFile << "Order History:" << endl;
-    outFile << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
-    outFile << setw(20) << left << "Customer name" << setw(15) << left << "Dine Option" 
-            << setw(30) << left << "Food Details" << setw(10) << left << "Quantity" 
-            << setw(10) << left << "Price" << setw(15) << left << "Total Price" << "Order Time" << endl;
-    outFile << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+void exportToText(const OrderBook &book) {
+    exportOrders(book, "orders_export.txt", tableHeading(), appendTableRow);
+}
 
-    for (const auto &order : orders) {
-        outFile << setw(20) << left << order.customerName
-                << setw(15) << left << (order.dineOption == "t" ? "Take away" : "Dine in")
-                << setw(30) << left << order.foodDetails
-                << setw(10) << left << order.quantity
-                << setw(10) << left << fixed << setprecision(2) << order.price
-                << setw(15) << left << fixed << setprecision(2) << order.totalPrice
-                << order.orderTime << endl;
+// One checkout as table rows: the first carries the order number, customer,
+// dine option and time, the rest only the items, then the checkout total
+void displayCheckout(const OrderBook &book, const OrderHeader &header) 
+{
+    for (uint32_t i = 0; i < header.lineCount; ++i) 
+    {
+        const OrderLine &line = book.lines[header.firstLine + i];
+        bool first = i == 0;
+        cout << setw(10) << left << (first ? to_string(header.orderId) : "")
+             << setw(20) << left << (first ? book.customerOf(header) : "")
+             << setw(15) << left << (first ? (book.dineOptionOf(header) == "t" ? "Take away" : "Dine in") : "")
+             << setw(30) << left << book.foodOf(line)
+             << setw(10) << left << line.quantity
+             << setw(10) << left << line.price
+             << setw(15) << left << line.quantity * line.price
+             << (first ? OrderLog::timeText(header.orderTime) : "") << endl;
+    }
+    if (header.lineCount > 1) 
+    {
+        cout << setw(85) << "" << setw(10) << left << "Total" << header.total << endl;
     }
+}
 
-    outFile.close();
-    cout << "Orders have been exported to orders_export.txt" << endl;
+void displayOrderBookHeading() 
+{
+    cout << setw(10) << left << "Order" << setw(20) << left << "Customer name" << setw(15) << left << "Dine Option" 
+         << setw(30) << left << "Food Details" << setw(10) << left << "Quantity" 
+         << setw(10) << left << "Price" << setw(15) << left << "Total Price" << "Order Time" << endl;
 }
 
-void viewOrderHistory() 
+// One page of the history. With the page index only that page is read from
+// orders.log; without it the page is cut from the history loaded in memory.
+// orderCount and revenue cover the whole history; they are worked out once
+// when the history is opened, not on every page turn
+void displayHistoryPage(const OrderPageIndex &pages, bool indexed, const OrderBook &history, size_t page, size_t pageCount,
+                        uint64_t orderCount, Money revenue) 
 {
-    ifstream orderFile("orders.txt");
-    if (!orderFile) 
+    OrderBook pageBook;
+    const OrderBook *source = &history;
+    size_t first = page * OrderPageIndex::PAGE_ORDERS;
+    size_t end = min(history.orders.size(), first + OrderPageIndex::PAGE_ORDERS);
+    if (indexed) 
     {
-        cerr << "Failed to open orders.txt" << endl;
-        return;
+        string error;
+        if (!pages.readPage(page, pageBook, error)) 
+        {
+            if (pageCount > 0) 
+            {
+                cerr << "orders.log: " << error << endl;
+            }
+        }
+        source = &pageBook;
+        first = 0;
+        end = pageBook.orders.size();
     }
 
-    vector<Order> orders;
-    string line;
-
-    while (getline(orderFile, line)) 
+    cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    cout << "Order History (page " << (pageCount == 0 ? 0 : page + 1) << " of " << pageCount << "):" << endl;
+    cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    displayOrderBookHeading();
+    for (size_t i = first; i < end; ++i) 
     {
-        stringstream ss(line);
-        Order order;
-
-        getline(ss, order.customerName, ',');
-        getline(ss, order.dineOption, ',');
-        getline(ss, order.foodDetails, ',');
-        ss >> order.quantity;
-        ss.ignore(); // Ignore the comma after quantity
-        ss >> order.price;
-        ss.ignore(); // Ignore the comma after price
-        getline(ss, order.orderTime);
-
-        // Calculate total price for the order
-        order.totalPrice = order.quantity * order.price;
-
-        orders.push_back(order);
+        displayCheckout(*source, source->orders[i]);
     }
-    
-    orderFile.close();
     cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << "Order History:" << endl;
+
+    cout << orderCount << " orders, total revenue: RM " << revenue << endl;
     cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
-    cout << setw(20) << left << "Customer name" << setw(15) << left << "Dine Option" 
-         << setw(30) << left << "Food Details" << setw(10) << left << "Quantity" 
-         << setw(10) << left << "Price" << setw(15) << left << "Total Price" << "Order Time" << endl;
+}
 
-    for (const auto &order : orders) 
+// Opens on the newest page of the history. Paging reads only the page shown;
+// the whole history is loaded only for the options that need all of it.
+void viewOrderHistory() 
+{
+    OrderPageIndex pages;
+    OrderBook history;
+    string error;
+    bool indexed = orderWriter.logsOrders() && pages.open("orders.pages", "orders.log", error);
+    bool loaded = false;
+    if (!indexed) 
     {
-        cout << setw(20) << left << order.customerName
-             << setw(15) << left << (order.dineOption == "t" ? "Take away" : "Dine in")
-             << setw(30) << left << order.foodDetails
-             << setw(10) << left << order.quantity
-             << setw(10) << left << fixed << setprecision(2) << order.price
-             << setw(15) << left << fixed << setprecision(2) << order.totalPrice
-             << order.orderTime << endl;
+        if (!error.empty()) 
+        {
+            cerr << "orders.log: " << error << ", reading orders.txt instead" << endl;
+        }
+        if (!OrderHistoryLoader::load("orders.log", "orders.txt", orderWriter.logsOrders(), history)) 
+        {
+            cerr << "Failed to open orders.txt" << endl;
+            return;
+        }
+        loaded = true;
     }
 
-    cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    size_t pageOrders = OrderPageIndex::PAGE_ORDERS;
+    size_t pageCount = indexed ? pages.pageCount() : (history.orders.size() + pageOrders - 1) / pageOrders;
+    size_t page = pageCount > 0 ? pageCount - 1 : 0;
+    uint64_t orderCount = indexed ? pages.orderCount() : history.orders.size();
+    Money revenue = indexed ? pages.revenue() : historyRevenue(history);
+    displayHistoryPage(pages, indexed, history, page, pageCount, orderCount, revenue);
 
     while (true) 
     {
@@ -711,10 +7092,29 @@ void viewOrderHistory()
         cout << "2. Sort orders by latest order time" << endl;
         cout << "3. Export" << endl;
         cout << "4. Back" << endl;
+        cout << "5. Sort full history on disk" << endl;
+        cout << "6. Today's orders" << endl;
+        cout << "7. Orders between two dates" << endl;
+        cout << "8. Search orders by food item" << endl;
+        cout << "9. Next page" << endl;
+        cout << "10. Previous page" << endl;
+        cout << "11. Go to page" << endl;
+        cout << "12. Go to date" << endl;
         cout << "Enter your choice: ";
         int adminChoice;
         cin >> adminChoice;
 
+        // Sorting and exporting work on the whole history, so it is loaded for them
+        if ((adminChoice == 2 || adminChoice == 3) && !loaded) 
+        {
+            if (!OrderHistoryLoader::load("orders.log", "orders.txt", orderWriter.logsOrders(), history)) 
+            {
+                cerr << "Failed to open orders.txt" << endl;
+                continue;
+            }
+            loaded = true;
+        }
+
         if (adminChoice == 1) 
         {
             searchOrderByCustomerName(); // Assuming this function is defined elsewhere
@@ -722,28 +7122,21 @@ void viewOrderHistory()
         else if (adminChoice == 2) 
         {
             system("cls");
-            mergeSort(orders, 0, orders.size() - 1);
+            vector<uint32_t> byTime = Algorithm::sortOrdersByTime(history.orders);
             cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
             cout << "Sorted Order History:" << endl;
             cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
-            cout << setw(20) << left << "Customer name" 
-                 << setw(15) << left << "Dine Option" 
-                 << setw(30) << left << "Food Details" 
-                 << setw(10) << left << "Quantity" 
-                 << setw(10) << left << "Price" 
-                 << setw(15) << left << "Total Price" << "Order Time" << endl;
-
-            for (const auto &order : orders) 
+            displayOrderBookHeading();
+
+            for (uint32_t row : byTime) 
             {
-                cout << setw(20) << left << order.customerName
-                     << setw(15) << left << (order.dineOption == "t" ? "Take away" : "Dine in")
-                     << setw(30) << left << order.foodDetails
-                     << setw(10) << left << order.quantity
-                     << setw(10) << left << fixed << setprecision(2) << order.price
-                     << setw(15) << left << fixed << setprecision(2) << order.totalPrice
-                     << order.orderTime << endl;
+                displayCheckout(history, history.orders[row]);
             }
             cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+
+            // Export keeps writing the history in the order last shown; the
+            // checkouts move, their lines stay where they are
+            applyPermutation(history.orders, byTime);
         } 
         else if (adminChoice == 3) 
         {
@@ -755,27 +7148,37 @@ void viewOrderHistory()
                 cout << "2. Export to Word" << endl;
                 cout << "3. Export to Text" << endl;
                 cout << "4. Back" << endl;
+                cout << "5. Export to columnar" << endl;
+                cout << "6. Export new orders to CSV (since the last CSV export)" << endl;
                 cout << "Enter your choice: ";
                 int exportChoice;
                 cin >> exportChoice;
 
                 if (exportChoice == 1) 
                 {
-                    exportToCSV(orders);
+                    exportToCSV(history);
                 } 
                 else if (exportChoice == 2) 
                 {
-                    exportToWord(orders);
+                    exportToWord(history);
                 } 
                 else if (exportChoice == 3) 
                 {
-                    exportToText(orders);
+                    exportToText(history);
                 } 
                 else if (exportChoice == 4) 
                 {
                 	system("cls");
                     return;
                 } 
+                else if (exportChoice == 5) 
+                {
+                    exportToColumnar(history);
+                } 
+                else if (exportChoice == 6) 
+                {
+                    exportNewOrdersToCSV();
+                } 
                 else 
                 {
                     cout << "Invalid choice! Please try again." << endl;
@@ -787,6 +7190,85 @@ void viewOrderHistory()
             system("cls");
             break;
         } 
+        else if (adminChoice == 5) 
+        {
+            sortHistoryOnDisk();
+        } 
+        else if (adminChoice == 6) 
+        {
+            time_t now = time(nullptr);
+            tm local = {};
+#ifdef _WIN32
+            localtime_s(&local, &now);
+#else
+            localtime_r(&now, &local);
+#endif
+            local.tm_hour = local.tm_min = local.tm_sec = 0;
+            local.tm_isdst = -1;
+            time_t midnight = mktime(&local);
+            local.tm_mday += 1;
+            local.tm_isdst = -1;
+            showOrdersBetween(midnight, mktime(&local), "Today's Orders:");
+        } 
+        else if (adminChoice == 7) 
+        {
+            string first, last;
+            cout << "From date (YYYY-MM-DD): ";
+            cin >> first;
+            cout << "To date (YYYY-MM-DD, inclusive): ";
+            cin >> last;
+            time_t from, to;
+            if (!parseDate(first, 0, from) || !parseDate(last, 1, to) || to <= from) 
+            {
+                cout << "Invalid date range! Please try again." << endl;
+                continue;
+            }
+            showOrdersBetween(from, to, "Orders from " + first + " to " + last + ":");
+        } 
+        else if (adminChoice == 8) 
+        {
+            searchOrderByItem();
+        } 
+        else if (adminChoice >= 9 && adminChoice <= 12) 
+        {
+            size_t target = page;
+            if (adminChoice == 9) 
+            {
+                target = page + 1;
+            } 
+            else if (adminChoice == 10) 
+            {
+                target = page - 1;
+            } 
+            else if (adminChoice == 11) 
+            {
+                cout << "Page (1-" << pageCount << "): ";
+                size_t number = 0;
+                cin >> number;
+                target = number - 1;
+            } 
+            else 
+            {
+                string day;
+                cout << "Date (YYYY-MM-DD): ";
+                cin >> day;
+                time_t when;
+                if (!parseDate(day, 0, when)) 
+                {
+                    cout << "Invalid date! Please try again." << endl;
+                    continue;
+                }
+                target = indexed ? pages.pageAt(when) : historyPageAt(history, when);
+            }
+            if (target >= pageCount) 
+            {
+                cout << "No such page! Please try again." << endl;
+                continue;
+            }
+            page = target;
+            system("cls");
+            displayHistoryPage(pages, indexed, history, page, pageCount, orderCount, revenue);
+        } 
         else 
         {
             cout << "Invalid choice! Please try again." << endl;
@@ -794,6 +7276,181 @@ void viewOrderHistory()
     }
 }
 
+// Sum of the checkout totals of a loaded history
+static Money historyRevenue(const OrderBook &history) 
+{
+    vector<int64_t> totals;
+    totals.reserve(history.orders.size());
+    for (const auto &header : history.orders) 
+    {
+        totals.push_back(header.total.cents);
+    }
+    return Money::sum(totals.data(), totals.size());
+}
+
+// OrderPageIndex::pageAt for a loaded history: the page holding its first
+// order placed at or after when, or the last page when every order is older
+static size_t historyPageAt(const OrderBook &history, time_t when) 
+{
+    auto at = partition_point(history.orders.begin(), history.orders.end(), [when](const OrderHeader &header) 
+    {
+        return header.orderTime < when;
+    });
+    size_t i = (size_t)(at - history.orders.begin());
+    if (i == history.orders.size() && i > 0) 
+    {
+        --i;
+    }
+    return i / OrderPageIndex::PAGE_ORDERS;
+}
+
+// Local midnight at the start of a YYYY-MM-DD date, plus extraDays days
+static bool parseDate(const string& text, int extraDays, time_t& result) 
+{
+    int year, month, day;
+    char dash1, dash2;
+    stringstream ss(text);
+    if (!(ss >> year >> dash1 >> month >> dash2 >> day) || dash1 != '-' || dash2 != '-' ||
+        month < 1 || month > 12 || day < 1 || day > 31) 
+    {
+        return false;
+    }
+    tm local = {};
+    local.tm_year = year - 1900;
+    local.tm_mon = month - 1;
+    local.tm_mday = day + extraDays;
+    local.tm_isdst = -1;
+    result = mktime(&local);
+    return result != (time_t)-1;
+}
+
+// Reads only the log segments that can hold orders placed in [from, to)
+void showOrdersBetween(time_t from, time_t to, const string& title) 
+{
+    vector<Order> rows;
+    size_t segmentsRead = 0;
+    if (!OrderHistoryLoader::loadRange("orders.log", "orders.manifest", "orders.txt", orderWriter.logsOrders(), from, to, rows, segmentsRead)) 
+    {
+        cerr << "Failed to open orders.txt" << endl;
+        return;
+    }
+    vector<uint32_t> byTime = Algorithm::sortOrdersByTime(rows);
+
+    system("cls");
+    cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    cout << title << endl;
+    cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    cout << setw(20) << left << "Customer name" 
+         << setw(15) << left << "Dine Option" 
+         << setw(30) << left << "Food Details" 
+         << setw(10) << left << "Quantity" 
+         << setw(10) << left << "Price" 
+         << setw(15) << left << "Total Price" << "Order Time" << endl;
+
+    vector<int64_t> totals;
+    totals.reserve(rows.size());
+    unordered_set<uint64_t> checkouts;  // rows are items; a checkout's rows share its order id
+    for (uint32_t row : byTime) 
+    {
+        const Order &order = rows[row];
+        checkouts.insert(order.orderId);
+        cout << setw(20) << left << order.customerName
+             << setw(15) << left << (order.dineOption == "t" ? "Take away" : "Dine in")
+             << setw(30) << left << order.foodDetails
+             << setw(10) << left << order.quantity
+             << setw(10) << left << order.price
+             << setw(15) << left << order.totalPrice
+             << order.orderTime << endl;
+        totals.push_back(order.totalPrice.cents);
+    }
+    cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    cout << checkouts.size() << " orders, revenue: RM " << Money::sum(totals.data(), totals.size()) << endl;
+    if (segmentsRead > 0) 
+    {
+        cout << "(" << segmentsRead << " log segment" << (segmentsRead == 1 ? "" : "s") << " read)" << endl;
+    }
+    cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+}
+
+// Sorts the history as stored on disk rather than the copy loaded above, so it
+// works for logs larger than memory. The sorted stream goes straight to the
+// screen or an export file.
+void sortHistoryOnDisk() 
+{
+    cout << "Sort by: 1. Order time  2. Customer  3. Food  4. Total price" << endl;
+    cout << "Enter your choice: ";
+    int keyChoice;
+    cin >> keyChoice;
+    if (keyChoice < 1 || keyChoice > 4) 
+    {
+        cout << "Invalid choice! Please try again." << endl;
+        return;
+    }
+    const OrderSortKey keys[] = {OrderSortKey::Time, OrderSortKey::Customer, OrderSortKey::Item, OrderSortKey::Total};
+
+    cout << "1. Display  2. Export to CSV  3. Export to Word  4. Export to Text" << endl;
+    cout << "Enter your choice: ";
+    int outputChoice;
+    cin >> outputChoice;
+    if (outputChoice < 1 || outputChoice > 4) 
+    {
+        cout << "Invalid choice! Please try again." << endl;
+        return;
+    }
+
+    HistoryOrderStream history;
+    if (!history.open("orders.log", "orders.txt")) 
+    {
+        cerr << "Failed to open orders.txt" << endl;
+        return;
+    }
+    ExternalOrderSort sorted(keys[keyChoice - 1], sortMemoryBudget);
+    if (!sorted.sort(history)) 
+    {
+        cerr << "Failed to sort the order history" << endl;
+        return;
+    }
+
+    if (outputChoice == 2) 
+    {
+        exportToCSV(sorted);
+    } 
+    else if (outputChoice == 3) 
+    {
+        exportToWord(sorted);
+    } 
+    else if (outputChoice == 4) 
+    {
+        exportToText(sorted);
+    } 
+    else 
+    {
+        system("cls");
+        cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+        cout << "Sorted Order History:" << endl;
+        cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+        cout << setw(20) << left << "Customer name" 
+             << setw(15) << left << "Dine Option" 
+             << setw(30) << left << "Food Details" 
+             << setw(10) << left << "Quantity" 
+             << setw(10) << left << "Price" 
+             << setw(15) << left << "Total Price" << "Order Time" << endl;
+
+        Order order;
+        while (sorted.next(order)) 
+        {
+            cout << setw(20) << left << order.customerName
+                 << setw(15) << left << (order.dineOption == "t" ? "Take away" : "Dine in")
+                 << setw(30) << left << order.foodDetails
+                 << setw(10) << left << order.quantity
+                 << setw(10) << left << order.price
+                 << setw(15) << left << order.totalPrice
+                 << order.orderTime << endl;
+        }
+        cout << "-----------------------------------------------------------------------------------------------------------------------------------" << endl;
+    }
+}
+
 
 void simulateLoading() 
 {
@@ -940,7 +7597,7 @@ bool userLogin()
 }
     
     // Function to display order summary
-	void displayOrderSummary() {
+	void displayOrderSummary(const string& customerName, const string& dineOption) {
     system("cls");
     cout << "------------------------------------------" << endl;
     cout << "Receipt:" << endl;
@@ -948,7 +7605,7 @@ bool userLogin()
     for (const auto& order : orders) {
         cout << setw(27) << left << order.item << "x"
              << setw(5) << right << order.quantity << "  RM "
-             << fixed << setprecision(2) << order.price << endl;
+             << order.price << endl;
     }
     cout << "------------------------------------------" << endl;
     cout << "Total Price: \t\t\tRM " << calculateTotalPrice() << endl;
@@ -971,7 +7628,9 @@ bool userLogin()
             cout << "Thanks for using our system!" << endl;
             // Optionally, you can save the receipt to file here
             saveReceiptToFile();
+            recordOrder(customerName, dineOption);
             cout << endl;
+            orderWriter.stop();  // exit() skips destructors, so flush queued orders first
             exit(0);
 
         case 2:
@@ -986,9 +7645,9 @@ bool userLogin()
 
 
     // Function to calculate total price of all orders
-	double calculateTotalPrice() 
+	Money calculateTotalPrice() 
 	{
-    double total = 0.0;
+    Money total;
     for (const auto& order : orders) 
 	{
         total += order.price * order.quantity;
@@ -1023,7 +7682,7 @@ void saveReceiptToFile()
 		{
             receiptFile << setw(25) << left << order.item << " x"
                         << setw(5) << right << order.quantity << "  RM "
-                        << fixed << setprecision(2) << order.price << endl;
+                        << order.price << endl;
         }
         
         receiptFile << "------------------------------------------" << endl;
@@ -1042,9 +7701,18 @@ void saveReceiptToFile()
     
     
 public:
-    void startOrdering() 
+    void setSortMemoryBudget(size_t bytes) 
+	{
+        sortMemoryBudget = bytes;
+    }
+
+    void startOrdering(Durability durability = Durability::Batch) 
 	{
     	loadMenu();
+    	if (!orderWriter.start("orders.txt", "orders.log", "customers.idx", "orders.manifest", durability)) 
+		{
+    	    cerr << "Failed to open orders.txt" << endl;
+    	}
 
     	while (true) 
 		{
@@ -1091,7 +7759,7 @@ public:
 
 	                while (true) 
 					{
-	                    displayMenu(menu);
+	                    displayMenu(catalog.items(), menuIndex.view(menuOrder));
 	                    cout << "Choose an option:" << endl;
 	                    cout << "1. Sort by menu" << endl;
 	                    cout << "2. Search by menu" << endl;
@@ -1117,11 +7785,11 @@ public:
 	                        
 		                        if (userchoice == 1) 
 								{
-		                            Algorithm::bubbleSortMenuByName(menu);
+		                            menuOrder = MenuOrder::ByName;
 		                        } 
 								else if (userchoice == 2) 
 								{
-		                            Algorithm::bubbleSortMenuByPrice(menu);
+		                            menuOrder = MenuOrder::ByPriceDesc;
 		                        }
 	                    } 
 						else if(menuChoice == 2) 
@@ -1130,6 +7798,8 @@ public:
 	                        cout << "*********************************" << endl;
 						    cout << "1. Search food by price range" << endl;
 						    cout << "2. Search food by food type" << endl;
+						    cout << "3. Search food by name" << endl;
+						    cout << "4. Search food by food type and price range" << endl;
 						    cout << "*********************************" << endl;
 
 						    cout << "Enter your choice: ";
@@ -1138,14 +7808,14 @@ public:
 
 						    if (userChoice == 1) 
 							{
-						        double minPrice, maxPrice;
+						        Money minPrice, maxPrice;
 						        cout << "Enter minimum price: ";
 						        cin >> minPrice;
 						        cout << "Enter maximum price: ";
 						        cin >> maxPrice;
 
 						        // Perform initial search and display
-						        vector<MenuItem> results = SearchItem::searchByPriceRange(menu, minPrice, maxPrice);
+						        vector<MenuItem> results = SearchItem::searchByPriceRange(catalog.items(), menuIndex, minPrice, maxPrice);
 						        displayMenu(results);
 
 								while (true) 
@@ -1164,7 +7834,7 @@ public:
 						                cin >> maxPrice;
 
 						                // Perform search again
-						                results = SearchItem::searchByPriceRange(menu, minPrice, maxPrice);
+						                results = SearchItem::searchByPriceRange(catalog.items(), menuIndex, minPrice, maxPrice);
 						                displayMenu(results);
 		                
 			            			} 
@@ -1186,7 +7856,7 @@ public:
 						        cin >> category;
 			
 						        // Perform initial search and display
-						        vector<MenuItem> results = SearchItem::searchByCategory(menu, category);
+						        vector<MenuItem> results = SearchItem::searchByCategory(catalog.items(), menuIndex, category);
 						        displayMenu(results);
 
 						        while (true) 
@@ -1203,7 +7873,94 @@ public:
 						                cin >> category;
 						
 						                // Perform search again
-						                results = SearchItem::searchByCategory(menu, category);
+						                results = SearchItem::searchByCategory(catalog.items(), menuIndex, category);
+						                displayMenu(results);
+						            } 
+									else if (searchChoice == 2) 
+									{
+						                system("cls"); // Clear screen if needed
+						                break; // Exit the search loop and go back to main menu
+						            } 
+									else 
+									{
+						                cout << "Invalid choice! Please try again." << endl;
+						            }
+			        			}
+			    			}
+							else if (userChoice == 3) 
+							{
+						        string prefix;
+						        cout << "Enter the start of a food name: ";
+						        cin.ignore();
+						        getline(cin, prefix);
+
+						        // Perform initial search and display
+						        vector<MenuItem> results = findItemsByName(prefix, 10);
+						        displayMenu(results);
+
+						        while (true) 
+								{
+						            cout << "1. Continue searching" << endl;
+						            cout << "2. Back to menu" << endl;
+						            cout << "Enter your choice: ";
+						            int searchChoice;
+						            cin >> searchChoice;
+
+						            if (searchChoice == 1) 
+									{
+						                cout << "Enter the start of a food name: ";
+						                cin.ignore();
+						                getline(cin, prefix);
+
+						                // Perform search again
+						                results = findItemsByName(prefix, 10);
+						                displayMenu(results);
+						            } 
+									else if (searchChoice == 2) 
+									{
+						                system("cls"); // Clear screen if needed
+						                break; // Exit the search loop and go back to main menu
+						            } 
+									else 
+									{
+						                cout << "Invalid choice! Please try again." << endl;
+						            }
+			        			}
+			    			}
+							else if (userChoice == 4) 
+							{
+						        string category;
+						        Money minPrice, maxPrice;
+						        cout << "Enter food type (burger/pizza/cake/snack): ";
+						        cin >> category;
+						        cout << "Enter minimum price: ";
+						        cin >> minPrice;
+						        cout << "Enter maximum price: ";
+						        cin >> maxPrice;
+
+						        // Perform initial search and display
+						        vector<MenuItem> results = SearchItem::searchByCategoryAndPrice(catalog.items(), menuIndex, category, minPrice, maxPrice);
+						        displayMenu(results);
+
+						        while (true) 
+								{
+						            cout << "1. Continue searching" << endl;
+						            cout << "2. Back to menu" << endl;
+						            cout << "Enter your choice: ";
+						            int searchChoice;
+						            cin >> searchChoice;
+
+						            if (searchChoice == 1) 
+									{
+						                cout << "Enter food type (burger/pizza/cake/snack): ";
+						                cin >> category;
+						                cout << "Enter minimum price: ";
+						                cin >> minPrice;
+						                cout << "Enter maximum price: ";
+						                cin >> maxPrice;
+
+						                // Perform search again
+						                results = SearchItem::searchByCategoryAndPrice(catalog.items(), menuIndex, category, minPrice, maxPrice);
 						                displayMenu(results);
 						            } 
 									else if (searchChoice == 2) 
@@ -1223,8 +7980,8 @@ public:
 	                        while (true) 
 							{
 	                            system("cls");
-	                            menu = originalMenu;
-	                            displayMenu(menu);
+	                            menuOrder = MenuOrder::Original;
+	                            displayMenu(catalog.items());
 	                            string itemCode;
 	                            string BeverageCode;
 	                            int quantity;
@@ -1232,10 +7989,10 @@ public:
 	                            cout << "Enter the food code you wish to order: ";
 	                            cin >> itemCode;
 
-	                            auto it = menuMap.find(itemCode);
-	                            if (it != menuMap.end()) 
+	                            const MenuItem* found = catalog.find(itemCode);
+	                            if (found) 
 								{
-	                                MenuItem item = menuMap[itemCode];
+	                                const MenuItem& item = *found;
 	                                
 	                                cout << "----------------------------" << endl;
 	                                cout << item.name << endl;
@@ -1244,7 +8001,8 @@ public:
 	                                cout << "Enter the quantity: ";
 	                                cin >> quantity;
 	
-	                                OrderItem orderItem = { item.name, quantity, item.price };
+	                                OrderItem orderItem = { string(item.name), quantity, item.price };
+	                                orderItem.itemId = MenuCatalog::packCode(item.code);
 	                                orders.push_back(orderItem);
 	
 	                                cout << "Would you like to add a beverage? (yes/no): ";
@@ -1266,38 +8024,39 @@ public:
 	                                    cout << "Enter the quantity: ";
 	                                    cin >> quantity;
 
-	                                    double beveragePrice = 0.0;
+	                                    Money beveragePrice;
 	                                    if (BeverageCode == "D01") 
 										{
-	                                        beveragePrice = 2.00;
+	                                        beveragePrice = Money(200);
 	                                    } 
 										else if (BeverageCode == "D02") 
 										{
-	                                        beveragePrice = 3.00;
+	                                        beveragePrice = Money(300);
 	                                    } 
 										else if (BeverageCode == "D03") 
 										{
-	                                        beveragePrice = 2.50;
+	                                        beveragePrice = Money(250);
 	                                    } 
 										else if (BeverageCode == "D04") 
 										{
-	                                        beveragePrice = 4.00;
+	                                        beveragePrice = Money(400);
 	                                    } 
 										else if (BeverageCode == "D05") 
 										{
-	                                        beveragePrice = 1.00;
+	                                        beveragePrice = Money(100);
 	                                    } 
 										else 
 										{
 	                                        cout << "Invalid beverage code!" << endl;
 	                                    }
 
-	                                    if (beveragePrice > 0.0) 
+	                                    if (beveragePrice > Money()) 
 										{
 	                                        OrderItem beverageOrder = { (BeverageCode == "D01" ? "Tea" :
 	                                        BeverageCode == "D02" ? "Coffee" :
 	                                        BeverageCode == "D03" ? "Soft Drink" :
 	                                        BeverageCode == "D04" ? "Juice" : "Water"), quantity, beveragePrice };
+	                                        beverageOrder.itemId = MenuCatalog::packCode(BeverageCode);
 	                                        orders.push_back(beverageOrder);
 	                                    }
                                 	}
@@ -1305,6 +8064,14 @@ public:
 								else 
 								{
                                 	cout << "Invalid item code!" << endl;
+
+                                	// The customer may have typed part of a name instead of a code
+                                	vector<MenuItem> suggestions = findItemsByName(itemCode, 5);
+                                	if (!suggestions.empty()) 
+									{
+                                	    cout << "Did you mean:" << endl;
+                                	    displayMenu(suggestions);
+                                	}
                            	 	}
 
 				                            cout << "Would you like to order another item? (yes/no): ";
@@ -1313,8 +8080,7 @@ public:
                             
 	                            if (moreItems == "no") 
 								{
-	                                displayOrderSummary();
-	                                recordOrder(customerName, dineOption);
+	                                displayOrderSummary(customerName, dineOption);
 	                                break; // Exit after showing receipt
 	                                orders.clear();
 	                            }
@@ -1361,19 +8127,30 @@ public:
 
                     if (adminChoice == 1) 
 					{
+                        string code, name, category;
                         MenuItem newItem;
                         cout << "Enter food code: ";
-                        cin >> newItem.code;
+                        cin >> code;
                         cout << "Enter food name: ";
                         cin.ignore();
-                        getline(cin, newItem.name);
+                        getline(cin, name);
                         cout << "Enter food category: ";
-                        getline(cin, newItem.category);
+                        getline(cin, category);
                         cout << "Enter food price: ";
                         cin >> newItem.price;
-                        admin.addMenuItem(menu, newItem);
-                        menuMap[newItem.code] = newItem;
-                        admin.saveMenuToFile(menu);
+                        // catalog.add() copies the strings into the catalog
+                        newItem.code = code;
+                        newItem.name = name;
+                        newItem.category = category;
+                        if (admin.addMenuItem(catalog, nameIndex, newItem)) 
+						{
+                            menuIndex.build(catalog.items());
+                            admin.saveMenuToFile(catalog.items());
+                        } 
+						else 
+						{
+                            cout << "Food code " << newItem.code << " is invalid or already in use (1-4 characters, no spaces or commas)." << endl;
+                        }
                     } 
 					else if (adminChoice == 2) 
 					{
@@ -1382,10 +8159,10 @@ public:
                         cin >> editCode;
 
                         // Get item details using Admin class method
-                        MenuItem itemToEdit = admin.getMenuItemDetails(editCode, menuMap);
+                        const MenuItem* itemToEdit = admin.getMenuItemDetails(editCode, catalog);
 
                         // Check if the item exists
-                        if (itemToEdit.code == "") 
+                        if (!itemToEdit) 
 						{
                             cout << "Item with code " << editCode << " not found." << endl;
                         } 
@@ -1394,13 +8171,14 @@ public:
                             cout << "********************************" << endl;
                             cout << "  Current details of item " << editCode << ":" << endl;
                             cout << "********************************" << endl;
-                            cout << "Name: " << itemToEdit.name << endl;
-                            cout << "Category: " << itemToEdit.category << endl;
-                            cout << "Price: RM " << fixed << setprecision(2) << itemToEdit.price << endl;
+                            cout << "Name: " << itemToEdit->name << endl;
+                            cout << "Category: " << itemToEdit->category << endl;
+                            cout << "Price: RM " << itemToEdit->price << endl;
 
                             // Proceed to edit the item (your existing editMenuItem function call)
-                            admin.editMenuItem(menu, menuMap, editCode);
-                            admin.saveMenuToFile(menu);
+                            admin.editMenuItem(catalog, nameIndex, editCode);
+                            menuIndex.build(catalog.items());
+                            admin.saveMenuToFile(catalog.items());
 
                             cout << "Item " << editCode << " has been updated." << endl;
                         }
@@ -1410,13 +8188,20 @@ public:
                         cout << "Enter the code of the item to remove: ";
                         string removeCode;
                         cin >> removeCode;
-                        admin.removeMenuItem(menu, removeCode);
-                        admin.saveMenuToFile(menu);
+                        if (admin.removeMenuItem(catalog, nameIndex, removeCode)) 
+						{
+                            menuIndex.build(catalog.items());
+                            admin.saveMenuToFile(catalog.items());
+                        } 
+						else 
+						{
+                            cout << "Item with code " << removeCode << " not found." << endl;
+                        }
                     } 
 					else if (adminChoice == 4) 
 					{
                         system("cls");
-                        displayMenu(menu);
+                        displayMenu(catalog.items());
                     } 
 					else if (adminChoice == 5) 
 					{
@@ -1440,10 +8225,39 @@ public:
 };
 
 
-int main() 
+int main(int argc, char* argv[]) 
 {
+    // --durability=none|batch|order picks how long a checkout waits for orders.txt
+    // --sort-memory=<MB> caps the memory of the on-disk history sort
+    Durability durability = Durability::Batch;
+    size_t sortMemory = ExternalOrderSort::DEFAULT_MEMORY_BUDGET;
+    for (int i = 1; i < argc; ++i) 
+	{
+        string arg = argv[i];
+        if (arg.compare(0, 14, "--sort-memory=") == 0) 
+		{
+            size_t megabytes = 0;
+            auto result = from_chars(arg.data() + 14, arg.data() + arg.size(), megabytes);
+            if (result.ec != errc() || result.ptr != arg.data() + arg.size() || megabytes == 0) 
+			{
+                cerr << "Invalid --sort-memory: " << arg << endl;
+                return 1;
+            }
+            sortMemory = megabytes << 20;
+        }
+        else if (arg == "--durability=none") durability = Durability::None;
+        else if (arg == "--durability=batch") durability = Durability::Batch;
+        else if (arg == "--durability=order") durability = Durability::PerOrder;
+        else 
+		{
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
     FastFoodOrderingSystem system;
-    system.startOrdering();
+    system.setSortMemoryBudget(sortMemory);
+    system.startOrdering(durability);
     return 0;
 }
 